@@ -0,0 +1,258 @@
+// getline is POSIX, hidden by a strict -std=c11
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "protocol.h"
+
+/*
+ * converts the command traces from the text protocol to the binary one, and the binary
+ * responses of the engine back to text, so that they can be compared to the expected outputs.
+ *
+ *   converter < input.txt > input.bin           encodes the commands read from stdin
+ *   converter opens/open_1.txt ...              encodes every file in a .bin file next to it
+ *   converter -d < output.bin > output.txt      decodes the responses read from stdin
+ */
+
+/*** FUNCTION DECLARATION ***/
+unsigned parse_field(const char *);
+
+int get_opcode(const char *);
+
+void write_varint(unsigned, FILE *);
+
+void encode(FILE *, FILE *);
+
+int read_varint(FILE *, unsigned *);
+
+int decode(FILE *, FILE *);
+
+int encode_file(const char *);
+
+/*** FUNCTION DEFINITION ***/
+
+/**
+ * @brief parses the leading decimal digits of a field, ignoring whatever follows them as the engine does.
+ *
+ * @param field the field to parse.
+ * @return unsigned the parsed integer.
+ */
+unsigned parse_field(const char *field) {
+  unsigned value = 0;
+  while (*field >= '0' && *field <= '9')
+    value = value * 10 + (*field++ - '0');
+
+  return value;
+}
+
+/**
+ * @brief gets the opcode of the given command.
+ *
+ * @param command the name of the command.
+ * @return int the opcode of the command, or 0 if the command is unknown.
+ */
+int get_opcode(const char *command) {
+  if (strcmp(command, add_station_msg) == 0)
+    return add_station_op;
+  if (strcmp(command, remove_station_msg) == 0)
+    return remove_station_op;
+  if (strcmp(command, add_car_msg) == 0)
+    return add_car_op;
+  if (strcmp(command, remove_car_msg) == 0)
+    return remove_car_op;
+  if (strcmp(command, plan_route_msg) == 0)
+    return plan_route_op;
+
+  return 0;
+}
+
+/**
+ * @brief writes the given integer as a varint.
+ *
+ * @param value the integer to write.
+ * @param output where to write it.
+ */
+void write_varint(unsigned value, FILE *output) {
+  unsigned char encoded[max_varint_length];
+  fwrite(encoded, 1, encode_varint(value, encoded), output);
+}
+
+/**
+ * @brief encodes the text commands of the input in the binary protocol.
+ * unknown commands and commands with missing operands are dropped, as the engine would ignore them.
+ *
+ * @param input the text commands.
+ * @param output where to write the binary commands.
+ */
+void encode(FILE *input, FILE *output) {
+  char *line = NULL;
+  size_t capacity = 0;
+
+  // the operands of the current command
+  unsigned *operands = NULL;
+  int operands_capacity = 0;
+
+  fwrite(binary_magic, 1, binary_magic_length, output);
+
+  while (getline(&line, &capacity, input) != -1) {
+    char *command = strtok(line, " \n");
+    if (command == NULL)
+      continue;
+
+    int opcode = get_opcode(command);
+    if (opcode == 0)
+      continue;
+
+    int count = 0;
+    for (char *field = strtok(NULL, " \n"); field != NULL; field = strtok(NULL, " \n")) {
+      if (count == operands_capacity) {
+        operands_capacity = operands_capacity == 0 ? 16 : operands_capacity * 2;
+        operands = realloc(operands, sizeof(unsigned) * operands_capacity);
+      }
+      operands[count++] = parse_field(field);
+    }
+
+    int arity = opcode == remove_station_op ? 1 : 2;
+    if (count < arity)
+      continue;
+
+    // a new station lists only the cars that are actually there
+    if (opcode == add_station_op) {
+      if (operands[1] > (unsigned) count - 2)
+        operands[1] = count - 2;
+      arity += (int) operands[1];
+    }
+
+    fputc(opcode, output);
+    for (int i = 0; i < arity; i++)
+      write_varint(operands[i], output);
+  }
+
+  free(operands);
+  free(line);
+}
+
+/**
+ * @brief reads a varint.
+ *
+ * @param input where to read it from.
+ * @param value where to store the integer read.
+ * @return int 1 if the integer has been read, 0 otherwise.
+ */
+int read_varint(FILE *input, unsigned *value) {
+  unsigned result = 0;
+  for (int shift = 0; shift < 7 * max_varint_length; shift += 7) {
+    int byte = fgetc(input);
+    if (byte == EOF)
+      return 0;
+
+    result |= (unsigned) (byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * @brief decodes the binary responses of the engine to the text protocol.
+ *
+ * @param input the binary responses.
+ * @param output where to write the text responses.
+ * @return int 0 if all the responses have been decoded, 1 if the input is malformed.
+ */
+int decode(FILE *input, FILE *output) {
+  int code;
+  while ((code = fgetc(input)) != EOF) {
+    if (code == 0 || code > max_code)
+      return 1;
+
+    if (code != route_code) {
+      fprintf(output, "%s\n", response_messages[code]);
+      continue;
+    }
+
+    unsigned length, distance;
+    if (!read_varint(input, &length))
+      return 1;
+
+    for (unsigned i = 0; i < length; i++) {
+      if (!read_varint(input, &distance))
+        return 1;
+      fprintf(output, i + 1 < length ? "%u " : "%u\n", distance);
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * @brief encodes the given text file in a file with the same name and the .bin extension.
+ *
+ * @param path the path of the file to encode.
+ * @return int 0 if the file has been encoded, 1 otherwise.
+ */
+int encode_file(const char *path) {
+  FILE *input = fopen(path, "r");
+  if (input == NULL) {
+    perror(path);
+    return 1;
+  }
+
+  // replaces the extension of the file, if any
+  size_t length = strlen(path);
+  const char *extension = strrchr(path, '.');
+  if (extension != NULL && strchr(extension, '/') == NULL)
+    length = extension - path;
+
+  char *output_path = malloc(length + sizeof(".bin"));
+  memcpy(output_path, path, length);
+  strcpy(output_path + length, ".bin");
+
+  FILE *output = fopen(output_path, "wb");
+  if (output == NULL) {
+    perror(output_path);
+    free(output_path);
+    fclose(input);
+    return 1;
+  }
+
+  encode(input, output);
+
+  free(output_path);
+  fclose(output);
+  fclose(input);
+  return 0;
+}
+
+/**
+ * @brief program execution entry point.
+ *
+ * @param argc the number of arguments.
+ * @param argv the arguments: -d to decode responses, or the paths of the files to encode.
+ * @return int 0 if the program successfully executed.
+ */
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "-d") == 0) {
+    if (decode(stdin, stdout) != 0) {
+      fprintf(stderr, "malformed binary responses\n");
+      return 1;
+    }
+    return 0;
+  }
+
+  if (argc == 1) {
+    encode(stdin, stdout);
+    return 0;
+  }
+
+  int result = 0;
+  for (int i = 1; i < argc; i++)
+    result |= encode_file(argv[i]);
+
+  return result;
+}
@@ -1,28 +1,137 @@
+// mmap, madvise and getopt are POSIX and BSD extensions, hidden by a strict -std=c11
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-
-#define add_station_msg "aggiungi-stazione"
-#define remove_station_msg "demolisci-stazione"
-#define add_car_msg "aggiungi-auto"
-#define remove_car_msg "rottama-auto"
-#define plan_route_msg "pianifica-percorso"
-
-#define added_msg "aggiunta"
-#define not_added_msg "non aggiunta"
-#define removed_msg "demolita"
-#define not_removed_msg "non demolita"
-#define scrapped_msg "rottamata"
-#define not_scrapped_msg "non rottamata"
-#define no_route_msg "nessun percorso"
-
-#define delim " \n"
+#include <limits.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef have_zlib
+#include <zlib.h>
+#endif
+
+#ifdef have_zstd
+#include <zstd.h>
+#endif
+
+#include "protocol.h"
+
+// perfect hash of the command names: no two of them share the same slot in the dispatch table
+#define command_hash(command, length) (((command)[2] + 3 * (length)) & 7)
+#define min_command_length ((int) sizeof(remove_car_msg) - 1)
+#define max_command_length ((int) sizeof(plan_route_msg) - 1)
 
 #define buffer_size 8192
+#define chunk_size (1 << 20)
+#define raw_size (1 << 18)
+#define number_of_chunks 2
+#define output_size (1 << 20)
+#define number_of_output_blocks 16
 #define max_cars 512
+// the number of cars stored inside a station, before its cars array gets allocated
+#define inline_cars 4
+#define parse_window_size (1 << 23)
+// how many decoded commands ahead the stations of the cars commands get prefetched
+#define prefetch_distance 8
+// the number of plans in a row after which the stations get frozen, if not given with -f
+#define default_freeze_threshold 4
+// the stations get frozen only once the plans in a row have collected this many times all the stations,
+// so that the copy costs at most a fraction of the collections it has already saved to the run
+#define freeze_payoff 2
+// the slabs of the pools are as large and as aligned as a transparent huge page
+#define slab_size (1 << 21)
+// the address space reserved up front for the slabs of all the pools, halved while it cannot be reserved.
+// the stations are addressed by their 32 bit index in it, so it must stay below 2^31 stations
+#define arena_size ((size_t) 1 << 36)
+#define initial_table_capacity 1024
+// the number of stations in every set of the station cache
+#define cache_ways 4
+#define default_cache_size 64
+// the number of routes remembered by the route cache, if not given with -r
+#define default_route_cache_size 1024
+// the routes are invalidated by the changes in their interval of distances, tracked with the precision of
+// 2^route_bucket_bits buckets of 2^route_shift distances each, from 0 up to the farthest station added.
+// the negative distances, which are not valid ones, all share the first bucket
+#define route_bucket_bits 16
+#define route_bucket(distance) ((distance) < 0 ? 0 : (int) ((uint32_t) (distance) >> route_shift))
+
+// multiplicative hash of a distance, for a table with the given power of 2 capacity: the slot is taken from the
+// high bits of the product, which depend on all the bits of the distance, unlike the low ones
+#define hash_distance(distance, capacity) \
+  ((unsigned) ((uint64_t) ((uint32_t) (distance) * 2654435769u) * (uint32_t) (capacity) >> 32))
+// hash of the two ends of a route, for a table with the given power of 2 capacity, from the high bits as above
+#define hash_route(distance1, distance2, capacity) \
+  ((unsigned) ((uint64_t) ((uint32_t) (distance1) * 2654435769u ^ (uint32_t) (distance2) * 0x85ebca6bu) * \
+               (uint32_t) (capacity) >> 32))
+
+// the indexes of the stations that can be selected at build time, with -Dstation_index=...
+#define rb_tree_index 1
+#define bplus_tree_index 2
+#define radix_bitmap_index 3
+#define sorted_arrays_index 4
+#define persistent_tree_index 5
+
+#ifndef station_index
+#define station_index rb_tree_index
+#endif
+
+#if station_index != rb_tree_index && station_index != bplus_tree_index && station_index != radix_bitmap_index && \
+    station_index != sorted_arrays_index && station_index != persistent_tree_index
+#error "unknown station index"
+#endif
+
+// the maximum number of stations of a leaf, and of children of an inner node, of the B+ tree
+#define leaf_order 32
+#define inner_order 32
+// bound on the height of the B+ tree: its nodes are at least half full, so 2^31 stations fit in 8 levels
+#define max_tree_height 8
+
+// the number of bits of a key consumed by every level of the radix bitmap, and the level of its root:
+// 6 levels of 64 children cover the 32 bits of the distances
+#define radix_bits 6
+#define radix_height 5
+// the key of a distance in the radix bitmap: unsigned, in the same order as the distances
+#define radix_key(distance) ((uint64_t) ((uint32_t) (distance) ^ 0x80000000u))
+#define radix_distance(key) ((int) ((uint32_t) (key) ^ 0x80000000u))
+#define radix_slot(key, level) ((int) ((key) >> (radix_bits * (level)) & 63))
 
 // the input buffer
 char *buffer;
+// the buffer where the lines of the input are copied when they cannot be read in place
+char *line_buffer = NULL;
+// the size of the line buffer
+long line_buffer_capacity = 0;
+// the end of the current line in the input buffer
+char *line_end;
+// the end of the memory that can be safely read past the current line
+char *input_limit;
+
+
+// the memory mapped input file, or NULL if the input is read in chunks
+char *input_map = NULL;
+// the position of the next line in the memory mapped input or in the current chunk
+char *input_cursor = NULL;
+// the end of the memory mapped input or of the whole lines of the current chunk
+char *input_end = NULL;
+// the end of the memory that can be safely read past the memory mapped input or the current chunk
+char *input_readable_end = NULL;
+// the file descriptor from which the input is read when it cannot be memory mapped
+int input_fd = -1;
 
 // for convenience
 typedef enum boolean {
@@ -30,6 +139,145 @@ typedef enum boolean {
   true
 } boolean;
 
+/**
+ * @brief scanner of the command lines: the numeric fields of the lines it scans are appended to its fields array
+ */
+typedef struct scanner {
+  int *fields;
+  int number_of_fields;
+  // the number of fields that can be stored in the fields array before growing it
+  int capacity;
+} scanner_t;
+
+// the scanner of the lines played as soon as they are read
+scanner_t line_scanner;
+
+/**
+ * @brief compression of the input, detected from its first bytes
+ */
+typedef enum compression {
+  no_compression,
+  gzip_compression,
+  zstd_compression,
+} compression_t;
+
+compression_t input_compression = no_compression;
+// the raw bytes of the input, before the decompression
+unsigned char *raw_input = NULL;
+// the number of raw bytes read, and the number of them already decompressed
+long raw_length = 0;
+long raw_position = 0;
+// whether the raw bytes are the memory mapping of a compressed file, so they are never refilled
+boolean raw_mapped = false;
+
+#ifdef have_zlib
+z_stream gzip_stream;
+#endif
+
+#ifdef have_zstd
+ZSTD_DStream *zstd_stream = NULL;
+#endif
+
+/**
+ * @brief state of the chunks of the input, which pass from the reader to the player and back
+ */
+typedef enum chunk_state {
+  chunk_free,
+  chunk_ready,
+  chunk_playing,
+} chunk_state_t;
+
+/**
+ * @brief chunk of the input read ahead by the reader thread
+ */
+typedef struct chunk {
+  char *data;
+  // the number of bytes of the whole lines in the chunk
+  long length;
+  // the number of bytes read, including the partial line moved to the next chunk
+  long size;
+  long capacity;
+  // whether the chunk is the last one of the input
+  boolean last;
+  chunk_state_t state;
+} chunk_t;
+
+// the chunks of the input: one is played while the other one is filled by the reader
+chunk_t chunks[number_of_chunks];
+// the chunk being played
+int playing_chunk = -1;
+// whether the reader must split the chunks on new lines: not needed for a binary input
+atomic_int whole_lines = 1;
+
+pthread_t reader;
+pthread_mutex_t chunks_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t chunks_changed = PTHREAD_COND_INITIALIZER;
+
+// the output buffer, written to the standard output only when full
+char *output;
+// the number of bytes in the output buffer
+long output_length = 0;
+
+/**
+ * @brief block of output filled by the player and written by the writer thread
+ */
+typedef struct output_block {
+  char *data;
+  long length;
+} output_block_t;
+
+/**
+ * @brief lock-free ring of output blocks, with a single producer and a single consumer.
+ * the semaphore counts the blocks in the ring, so that the consumer can sleep while it is empty.
+ */
+typedef struct block_ring {
+  output_block_t *blocks[number_of_output_blocks];
+  atomic_int head;
+  atomic_int tail;
+  sem_t count;
+} block_ring_t;
+
+// whether the output is written by the writer thread, so that the player never waits for the standard output
+boolean async_output = false;
+// the block being filled by the player
+output_block_t *output_block = NULL;
+// the number of blocks allocated: less than the size of the rings, so that they can never overflow
+int allocated_output_blocks = 0;
+// the blocks to be written, in order, from the player to the writer
+block_ring_t filled_blocks;
+// the blocks already written, from the writer back to the player
+block_ring_t written_blocks;
+
+pthread_t writer;
+
+/**
+ * @brief response of the text protocol, including its new line
+ */
+typedef struct response_line {
+  const char *text;
+  int length;
+} response_line_t;
+
+#define response_line(msg) {msg "\n", sizeof(msg)}
+
+// the responses of the text protocol, indexed by response code
+const response_line_t response_lines[] = {
+    [added_code] = response_line(added_msg),
+    [not_added_code] = response_line(not_added_msg),
+    [removed_code] = response_line(removed_msg),
+    [not_removed_code] = response_line(not_removed_msg),
+    [scrapped_code] = response_line(scrapped_msg),
+    [not_scrapped_code] = response_line(not_scrapped_msg),
+    [no_route_code] = response_line(no_route_msg),
+};
+
+// the decimal representation of all the numbers with two digits, for the integer formatting
+const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+#if station_index == rb_tree_index
 /**
  * @brief color of the RB tree nodes
  */
@@ -39,17 +287,26 @@ typedef enum color {
 } color_t;
 
 /**
- * @brief node of the RB tree
+ * @brief node of the RB tree.
+ * the links are the indexes of the stations in the arena, counted from the null station which is the first one,
+ * so that a node with its inline cars fits in a cache line
  */
 typedef struct station {
   int distance;
-  color_t color;
-  struct station *left;
-  struct station *right;
-  struct station *parent;
+  uint32_t left;
+  uint32_t right;
+  // the highest bit is the color of the node
+  uint32_t parent;
+  // the stations before and after this one in ascending order of distance, so that
+  // the in-order steps never climb the tree. rotations do not change the order, so they leave them untouched
+  uint32_t previous;
+  uint32_t next;
   int number_of_cars;
   int max_range;
   int *cars;
+  int car_capacity;
+  // the first cars of the station, until they outgrow it
+  int local_cars[inline_cars];
 } station_t;
 
 // null station -> leaf in RB tree
@@ -57,987 +314,4734 @@ station_t *null_station = NULL;
 // root of RB tree
 station_t *root = NULL;
 
-/*** FUNCTION DECLARATION ***/
-char *get_token();
+// the station with the given index in the arena, and the index of the given station.
+// the slabs of the other pools are skipped by the indexes, as long as they hold whole stations
+#define station_at(index) (null_station + (index))
+#define index_of(station) ((uint32_t) ((station) - null_station))
+_Static_assert(slab_size % sizeof(station_t) == 0, "the slabs must hold whole stations");
+
+#define color_bit 0x80000000u
+#define left_of(x) station_at((x)->left)
+#define right_of(x) station_at((x)->right)
+#define parent_of(x) station_at((x)->parent & ~color_bit)
+#define color_of(x) ((color_t) ((x)->parent >> 31))
+#define set_left(x, y) ((x)->left = index_of(y))
+#define set_right(x, y) ((x)->right = index_of(y))
+#define set_parent(x, y) ((x)->parent = ((x)->parent & color_bit) | index_of(y))
+#define set_color(x, color) ((x)->parent = ((x)->parent & ~color_bit) | (uint32_t) (color) << 31)
+#elif station_index == bplus_tree_index
+/**
+ * @brief station stored in a leaf of the B+ tree
+ */
+typedef struct station {
+  int distance;
+  int number_of_cars;
+  int max_range;
+  int *cars;
+  int car_capacity;
+  // the first cars of the station, until they outgrow it
+  int local_cars[inline_cars];
+  // the leaf storing the station, updated whenever the station moves to another leaf
+  struct leaf *leaf;
+} station_t;
 
-int ascending(const void *, const void *);
+/**
+ * @brief leaf of the B+ tree.
+ * the distances and the maximum ranges of its stations are stored contiguously, in ascending order of distance,
+ * so that the planner scans them sequentially
+ */
+typedef struct leaf {
+  int number_of_stations;
+  int distances[leaf_order];
+  int max_ranges[leaf_order];
+  station_t *stations[leaf_order];
+  struct leaf *previous;
+  struct leaf *next;
+} leaf_t;
 
-int descending(const void *, const void *);
+/**
+ * @brief inner node of the B+ tree
+ */
+typedef struct inner_node {
+  int number_of_keys;
+  // the minimum distance that can be stored under every child but the first one
+  int keys[inner_order - 1];
+  void *children[inner_order];
+} inner_node_t;
+
+// null station -> returned when a station is not found
+station_t *null_station = NULL;
+// root of the B+ tree: a leaf if the height of the tree is 0
+void *root = NULL;
+int tree_height = 0;
+#elif station_index == radix_bitmap_index
+/**
+ * @brief station, found by distance through the hash table
+ */
+typedef struct station {
+  int distance;
+  int number_of_cars;
+  int max_range;
+  int *cars;
+  int car_capacity;
+  // the first cars of the station, until they outgrow it
+  int local_cars[inline_cars];
+} station_t;
 
-void swap(int *, int, int);
+/**
+ * @brief node of the radix bitmap of the distances, with one bit for each of its 64 children.
+ * only the children present are stored, contiguously and in order, so that the empty parts of the
+ * universe of the distances take no memory. the nodes of the lowest level have no children:
+ * their bits are the distances themselves
+ */
+typedef struct radix_node {
+  uint64_t bits;
+  struct radix_node *children;
+} radix_node_t;
 
-int contains_car(station_t *, int);
+// null station -> returned when a station is not found
+station_t *null_station = NULL;
+// root of the radix bitmap
+radix_node_t radix_root;
+#elif station_index == sorted_arrays_index
+/**
+ * @brief station, found by distance through the hash table.
+ * its distance and maximum range are also kept in the sorted arrays read by the planner,
+ * so that the station itself is only touched when its cars change
+ */
+typedef struct station {
+  int distance;
+  int number_of_cars;
+  int max_range;
+  int *cars;
+  int car_capacity;
+  // the first cars of the station, until they outgrow it
+  int local_cars[inline_cars];
+} station_t;
 
-station_t *init_station(int);
+// null station -> returned when a station is not found
+station_t *null_station = NULL;
+// the distances and the maximum ranges of all the stations, in ascending order of distance:
+// the planner reads its window directly from here
+int *hot_distances = NULL;
+int *hot_ranges = NULL;
+int hot_capacity = 0;
+#elif station_index == persistent_tree_index
+/**
+ * @brief station, found by distance through the hash table
+ */
+typedef struct station {
+  int distance;
+  int number_of_cars;
+  int max_range;
+  int *cars;
+  int car_capacity;
+  // the first cars of the station, until they outgrow it
+  int local_cars[inline_cars];
+} station_t;
 
-station_t *get_at(int);
+/**
+ * @brief node of a version of the persistent tree, a treap ordered by distance and by a priority derived from it.
+ * a node never changes once it is part of a version, so every change copies the path to the nodes it touches
+ * and the versions share all the other ones. a node counts the versions and the nodes that point to it:
+ * atomically, since a pinned version can be released by the thread that reads it
+ */
+typedef struct version_node {
+  int distance;
+  int max_range;
+  unsigned priority;
+  atomic_int references;
+  struct version_node *left;
+  struct version_node *right;
+} version_node_t;
 
-station_t *get_minimum(station_t *);
+// the priority of the node of the given distance in the treap: a hash, so that the shape of the tree
+// depends only on the stations and not on the order of the changes
+#define version_priority(distance) (((uint32_t) (distance) ^ (uint32_t) (distance) >> 16) * 0x45d9f3bu ^ 0x9e3779b9u)
 
-station_t *get_maximum(station_t *);
+// null station -> returned when a station is not found
+station_t *null_station = NULL;
+// the latest version of the tree, NULL while the route is empty
+version_node_t *current_version = NULL;
 
-station_t *get_successor_of(station_t *);
+/**
+ * @brief pinned version released for the last time by a thread that reads it, waiting to be freed
+ */
+typedef struct retired_version {
+  version_node_t *root;
+  struct retired_version *next;
+} retired_version_t;
 
-station_t *get_predecessor_of(station_t *);
+// only the thread that changes the tree touches its pool, so the other ones leave it the versions to free
+_Atomic(retired_version_t *) retired_versions = NULL;
+#endif
 
-void left_rotate(station_t *);
+/**
+ * @brief pool of objects of the same size, carved out of the slabs of the arena and recycled through a free list
+ */
+typedef struct pool {
+  size_t object_size;
+  // the recycled objects: each one stores the pointer to the next one
+  void *free_list;
+  // the part of the last slab that has never been used
+  char *slab_cursor;
+  char *slab_end;
+} pool_t;
+
+#define car_pool(capacity) {.object_size = sizeof(int) * (capacity)}
+// the index of the pool of the car arrays with the given capacity
+#define car_pool_of(capacity) __builtin_ctz((capacity) / (2 * inline_cars))
+
+// the region where the slabs of all the pools are committed, one after the other, backed by huge pages when possible
+char *arena = NULL;
+char *arena_cursor = NULL;
+char *arena_end = NULL;
+
+// the pool of the stations
+pool_t station_pool = {.object_size = sizeof(station_t)};
+// the pools of the car arrays, whose capacity doubles from twice the inline cars up to max_cars
+pool_t car_pools[] = {car_pool(8), car_pool(16), car_pool(32), car_pool(64), car_pool(128), car_pool(256), car_pool(512)};
+#if station_index == persistent_tree_index
+// the pool of the nodes of the versions of the tree
+pool_t version_pool = {.object_size = sizeof(version_node_t)};
+#endif
+
+// the number of stations in the route
+int number_of_stations = 0;
 
-void right_rotate(station_t *);
+/**
+ * @brief slot of the hash table of the stations
+ */
+typedef struct station_slot {
+  int distance;
+  // the station, or NULL if the slot is empty
+  station_t *station;
+} station_slot_t;
+
+// the hash table of the stations, indexed by distance with linear probing:
+// the tree is searched only for the ordered operations, while the exact lookups go through the table
+station_slot_t *station_table = NULL;
+// the number of slots of the table, always a power of 2 at least twice the number of stations
+int table_capacity = 0;
+
+// the stations frozen by a sequence of plans with no changes in between, in ascending order of distance,
+// and their distances in Eytzinger layout with the index of each one in ascending order.
+// the stations are frozen after freeze_threshold plans in a row that collected freeze_payoff times all of them,
+// or never if freeze_threshold is 0
+int *frozen_distances = NULL;
+int *frozen_ranges = NULL;
+int *eytzinger_distances = NULL;
+int *eytzinger_ranks = NULL;
+int frozen_capacity = 0;
+int number_of_frozen = 0;
+boolean frozen = false;
+int consecutive_plans = 0;
+long collected_in_a_row = 0;
+int freeze_threshold = default_freeze_threshold;
+
+// the stations between the two ends of the route being planned, in ascending order of distance:
+// copied here by the trees, while the sorted arrays only point it to their own stations
+int *window_distances = NULL;
+int *window_ranges = NULL;
+int window_capacity = 0;
+
+// the input tends to repeat multiple operations to the same few stations,
+// so cache the last ones used to avoid searching for them again.
+// the cache is set associative: a distance can only be in the ways of the set given by its hash,
+// which are kept from the most to the least recently used
+station_slot_t *station_cache = NULL;
+// the number of sets of the cache: a power of 2, or 0 if the cache is disabled
+int cache_sets = 0;
+// the number of lookups that found their station in the cache, and of the ones that had to search for it
+unsigned long cache_hits = 0;
+unsigned long cache_misses = 0;
 
-void insert_fixup(station_t *);
+/**
+ * @brief route remembered by the route cache
+ */
+typedef struct route_entry {
+  int distance1;
+  int distance2;
+  // the time of the plan: the route is valid until a change between its two ends
+  unsigned long planned_at;
+  // the stops of the route, ended by -1, or NULL if there is no route
+  int *route;
+  boolean used;
+} route_entry_t;
+
+// the routes planned last, each one in the entry given by the hash of its ends
+route_entry_t *route_cache = NULL;
+// the number of entries of the route cache: a power of 2, or 0 if the cache is disabled
+int route_cache_size = 0;
+// the time, counted in changes to the stations, and the time of the last change of every bucket of distances,
+// as a segment tree of maximums: the leaves are the buckets, and every node holds the last change under it
+unsigned long route_clock = 0;
+unsigned long *changed_at = NULL;
+// the buckets are as narrow as possible, and get twice as wide whenever a station is added beyond the last one
+int route_shift = 0;
+unsigned long route_hits = 0;
+unsigned long route_misses = 0;
 
-void delete_fixup(station_t *);
+/**
+ * @brief entry of the command dispatch table
+ */
+typedef struct command {
+  const char *name;
+  int length;
+  int opcode;
+  // the minimum number of operands
+  int arity;
+  void (*execute)(const int *, int);
+} command_t;
+
+// the dispatch table, indexed by the hash of the command names
+command_t commands[8];
+// the dispatch table of the binary protocol, indexed by opcode
+command_t *binary_commands[max_opcode + 1];
+
+// whether the input, and so the output, follow the binary protocol
+boolean binary_protocol = false;
+
+// the number of threads parsing the text input ahead of the player, or 0 to parse every line just before playing it
+int parser_threads = 0;
 
-void transplant(station_t *, station_t *);
+/**
+ * @brief command decoded by a parser thread: its operands are stored in the fields of the scanner of the parser
+ */
+typedef struct decoded_command {
+  int opcode;
+  // the number of operands
+  int count;
+  // the index of the first operand
+  int first;
+} decoded_command_t;
+
+// whether the given decoded command adds or scraps a car, and so looks up a station
+#define cars_command(decoded) \
+  (((decoded)->opcode == add_car_op || (decoded)->opcode == remove_car_op) && (decoded)->count > 0)
 
-station_t *add_station(int);
+/**
+ * @brief segment of a window of the input, decoded by a parser thread
+ */
+typedef struct parse_job {
+  char *start;
+  char *end;
+  // the end of the memory that can be safely read past the segment
+  const char *limit;
+  scanner_t scanner;
+  decoded_command_t *commands;
+  int number_of_commands;
+  int commands_capacity;
+  pthread_t thread;
+  // whether the segment is being parsed by its own thread, which must be joined
+  boolean running;
+} parse_job_t;
 
-boolean remove_station(int);
+/*** FUNCTION DECLARATION ***/
+int open_input(const char *);
 
-boolean add_car(station_t *, int);
+compression_t detect_compression(const unsigned char *, long);
 
-boolean remove_car(station_t *, int);
+int init_decompression();
 
-int *optimize(station_t **, int);
+int fill_raw();
 
-int *explore_forward(station_t *, station_t *);
+long read_input(char *, long);
 
-int *explore_backward(station_t *, station_t *);
+void *read_ahead(void *);
 
-int *plan_route(int, int);
+int next_chunk();
 
+int next_line();
 
-void play();
+void ensure_line_buffer(long);
 
-/*** FUNCTION DEFINITION ***/
+char *find_delimiter(char *, const char *, const char *);
 
-/**
- * @brief gets the next token from the input buffer
- */
-char *get_token() {
-  // gets the number of chars before it finds the delimiter
-  int len = strcspn(buffer, delim); // NOLINT(*-narrowing-conversions)
-  // if no other chars available
-  if (len == 0)
-    return NULL;
+unsigned parse_digits(const char *, int);
 
-  // replaces the space with a terminator character,
-  buffer[len] = '\0';
-  // and gets the command
-  char *curr = buffer;
-  // moves the pointer to the start of the next command
-  buffer += len + 1;
+void grow_fields(scanner_t *);
 
-  return curr;
-}
+char *scan_line(scanner_t *, char *, char *, const char *, int *);
 
-/**
- * @brief compares the two given elements. USED FOR ASCENDING ORDER.
- *
- * @param a the first element.
- * @param b the second element.
- * @return int indicates the order of the elements.
- */
-int ascending(const void *a, const void *b) {
-  return ((station_t *) a)->distance - ((station_t *) b)->distance;
-}
+void swap(int *, int, int);
 
-/**
- * @brief compares the two given elements. USED FOR DESCENDING ORDER.
- *
- * @param a the first element.
- * @param b the second element.
- * @return int indicates the order of the elements.
- */
-int descending(const void *a, const void *b) {
-  return *(int *) b - *(int *) a;
-}
+void sift_up(int *, int);
 
-/**
- * @brief swaps the elements at the given indexes of the given array.
- *
- * @param arr the array to swap the elements in.
- * @param i the first index.
- * @param j the second index.
- */
-void swap(int *arr, int i, int j) {
-  int temp = arr[i];
-  arr[i] = arr[j];
-  arr[j] = temp;
-}
+void sift_down(int *, int, int);
 
-/**
- * @brief searches the car with the given range in the given station.
- *
- * @param station the station where to search for the car.
- * @param range the range of the car to search.
- * @return int the index at which the car == found, -1 if no car == found.
- */
-int contains_car(station_t *station, int range) {
-  if (station == NULL || station == null_station || station->number_of_cars == 0)
-    return -1;
+int contains_car(station_t *, int);
 
-  // sorts the array in descending order
-  qsort(station->cars, station->number_of_cars, sizeof(int), descending);
+boolean reserve_arena();
 
-  // searches for the given range in the array.
-  // binary search algorithm
-  int l = 0, r = station->number_of_cars - 1;
-  while (l <= r) {
-    int mid = (int) (l + r) / 2;
-    if (station->cars[mid] == range)
-      return mid;
-
-    if (range > station->cars[mid]) {
-      r = mid - 1;
-    } else
-      l = mid + 1;
-  }
+char *new_slab();
 
-  // no car found
-  return -1;
-}
+long huge_page_memory();
 
-/**
- * @brief allocates memory and initializes a new station at the given distance.
- *
- * @param distance the distance where to put the station.
- * @return station_t* the newly created station.
- */
-station_t *init_station(int distance) {
-  station_t *new_station = malloc(sizeof(station_t));
+void *pool_alloc(pool_t *);
 
-  if (new_station != NULL) {
-    // initializes the distance field with the given distance,
-    // and all the other fields to default values
-    new_station->distance = distance;
-    new_station->color = black;
-    new_station->left = null_station;
-    new_station->right = null_station;
-    new_station->parent = null_station;
-    new_station->cars = (int *) calloc(max_cars, sizeof(int)); // array of 512 integers, all initialized to 0
-    new_station->max_range = 0;
-    new_station->number_of_cars = 0;
+void pool_free(pool_t *, void *);
 
-    return new_station;
-  }
+station_t *init_station(int);
 
-  return NULL;
-}
+void free_station(station_t *);
 
-/**
- * @brief gets the station at the given distance.
- * * DO NOT TOUCH! From Cormen book
- *
- * @param distance the distance at where the station should be found.
- * @return station_t* the found station, or NULL if none == found.
- */
-station_t *get_at(int distance) {
-  station_t *x = root;
-  while (x != NULL && x != null_station && x->distance != distance) {
-    if (distance < x->distance)
-      x = x->left;
-    else
-      x = x->right;
-  }
+boolean grow_cars(station_t *);
 
-  return x;
-}
+void set_max_range(station_t *, int);
 
-/**
- * @brief gets the station with the minimum distance from the given station.
- * * DO NOT TOUCH! From Cormen book
- *
- * @param x the station from where to begin the search.
- * @return station_t* the station with the minimum distance.
- */
-station_t *get_minimum(station_t *x) {
-  if (x == NULL || x == null_station)
-    return null_station;
+void ensure_window();
 
-  while (x->left != null_station)
-    x = x->left;
+station_t *get_from_table(int);
 
-  return x;
-}
+void grow_table();
 
-/**
- * @brief gets the station with the maximum distance from the given station.
- * * DO NOT TOUCH! From Cormen book
- *
- * @param x the station from where to begin the search.
- * @return station_t* the station with the maximum distance.
- */
-station_t *get_maximum(station_t *x) {
-  if (x == NULL || x == null_station)
-    return null_station;
+void add_to_table(station_t *);
 
-  while (x->right != null_station)
-    x = x->right;
+void remove_from_table(int);
 
-  return x;
-}
+void prefetch_slot(int);
 
-/**
- * @brief gets the station next to the given one in the route.
- * * DO NOT TOUCH! From Cormen book
- *
- * @param station the station from where to begin the search.
- * @return station_t* the next station.
- */
-station_t *get_successor_of(station_t *x) {
-  if (x == null_station)
-    return null_station;
+void prefetch_station(int);
 
-  if (x->right != null_station)
-    return get_minimum(x->right);
+void init_cache(int);
 
-  station_t *y = x->parent;
-  while (y != null_station && x == y->right) {
-    x = y;
-    y = y->parent;
-  }
-  return y;
-}
+void cache_station(station_t *);
 
-/**
- * @brief gets the station previous to the given one in the route.
- * * DO NOT TOUCH! From Cormen book
- *
- * @param station he station from where to begin the search.
- * @return station_t* the previous station.
- */
-station_t *get_predecessor_of(station_t *x) {
-  if (x == null_station)
-    return null_station;
+station_t *get_cached(int);
 
-  if (x->left != null_station)
-    return get_maximum(x->left);
+void uncache_station(int);
 
-  station_t *y = x->parent;
-  while (y != null_station && x == y->left) {
-    x = y;
-    y = y->parent;
-  }
+void init_route_cache(int);
 
-  return y;
-}
+void widen_route_buckets();
 
-/**
- * @brief rotates the sub tree with the given root to the left.
- * * DO NOT TOUCH! From Cormen book
- *
- * @param x the root of the sub tree to rotate.
- */
-void left_rotate(station_t *x) {
-  if (x->right == null_station)
-    return;
+void invalidate_routes(int);
 
-  station_t *y = x->right;
-  x->right = y->left;
+unsigned long last_change_between(int, int);
 
-  if (y->left != null_station)
-    y->left->parent = x;
-  y->parent = x->parent;
+route_entry_t *find_route(int, int);
 
-  if (x->parent == null_station)
-    root = y;
-  else if (x == x->parent->left)
-    x->parent->left = y;
-  else
-    x->parent->right = y;
+int *copy_route(const int *);
 
-  y->left = x;
-  x->parent = y;
-}
+void remember_route(int, int, const int *);
 
-/**
- * @brief rotates the sub tree with the given root to the right.
- * * DO NOT TOUCH! From Cormen book
- *
- * @param x the root of the sub tree to rotate.
- */
-void right_rotate(station_t *x) {
-  if (x->left == null_station)
-    return;
+#if station_index == rb_tree_index
+station_t *get_at(int);
 
-  station_t *y = x->left;
-  x->left = y->right;
+station_t *get_minimum(station_t *);
 
-  if (y->right != null_station)
-    y->right->parent = x;
-  y->parent = x->parent;
+station_t *get_maximum(station_t *);
 
-  if (x->parent == null_station)
-    root = y;
-  else if (x == x->parent->right)
-    x->parent->right = y;
-  else
-    x->parent->left = y;
+station_t *get_successor_of(station_t *);
 
-  y->right = x;
-  x->parent = y;
-}
+void left_rotate(station_t *);
+
+void right_rotate(station_t *);
+
+void insert_fixup(station_t *);
+
+void delete_fixup(station_t *);
+
+void transplant(station_t *, station_t *);
+
+station_t *add_station(int);
+
+boolean remove_station(int);
+
+int collect_stations(int, int);
+
+int minimum_distance();
+
+int maximum_distance();
+#elif station_index == bplus_tree_index
+int search_leaf(const leaf_t *, int);
+
+int search_inner(const inner_node_t *, int);
+
+leaf_t *find_leaf(int);
+
+station_t *get_at(int);
+
+void place_station(leaf_t *, int, station_t *);
+
+boolean reserve_splits(int, void **);
+
+int insert_into_leaf(leaf_t *, station_t *, void **, void **);
+
+int insert_into(void *, int, station_t *, void **, void **);
+
+station_t *add_station(int);
+
+void remove_child(inner_node_t *, int);
+
+void rebalance_leaves(inner_node_t *, int);
+
+void rebalance_inner_nodes(inner_node_t *, int);
+
+boolean remove_from(void *, int, int);
+
+boolean remove_station(int);
+
+int collect_stations(int, int);
+
+int minimum_distance();
+
+int maximum_distance();
+#elif station_index == radix_bitmap_index
+station_t *get_at(int);
+
+int radix_rank(const radix_node_t *, int);
+
+void radix_insert(uint64_t);
+
+boolean radix_remove(radix_node_t *, int, uint64_t);
+
+station_t *add_station(int);
+
+boolean remove_station(int);
+
+int radix_collect(const radix_node_t *, int, uint64_t, uint64_t, uint64_t, int);
+
+int collect_stations(int, int);
+
+int minimum_distance();
+
+int maximum_distance();
+#elif station_index == sorted_arrays_index
+station_t *get_at(int);
+
+int search_hot(int);
+
+station_t *add_station(int);
+
+boolean remove_station(int);
+
+int collect_stations(int, int);
+
+int minimum_distance();
+
+int maximum_distance();
+#elif station_index == persistent_tree_index
+station_t *get_at(int);
+
+version_node_t *new_node(int, int, version_node_t *, version_node_t *);
+
+version_node_t *retain(version_node_t *);
+
+void release(version_node_t *);
+
+version_node_t *pin_version();
+
+void unpin_version(version_node_t *);
+
+void free_retired_versions();
+
+void publish_version(version_node_t *);
+
+void split_version(const version_node_t *, int, version_node_t **, version_node_t **);
+
+version_node_t *merge_versions(const version_node_t *, const version_node_t *);
+
+version_node_t *insert_into_version(const version_node_t *, int, unsigned);
+
+version_node_t *remove_from_version(const version_node_t *, int);
+
+version_node_t *update_version(const version_node_t *, int, int);
+
+station_t *add_station(int);
+
+boolean remove_station(int);
+
+int count_version(const version_node_t *, int, int);
+
+int collect_version(const version_node_t *, int, int, int *, int *, int);
+
+boolean version_contains(const version_node_t *, int);
+
+int *plan_version(const version_node_t *, int, int);
+
+int collect_stations(int, int);
+
+int minimum_distance();
+
+int maximum_distance();
+#endif
+
+boolean add_car(station_t *, int);
+
+void add_cars(station_t *, const int *, int);
+
+boolean remove_car(station_t *, int);
+
+int fill_eytzinger(int, int);
+
+void freeze_stations();
+
+void thaw_stations();
+
+int search_frozen(int);
+
+int *optimize(const int *, const int *, int *, int);
+
+int *explore_forward(const int *, const int *, int);
+
+int *explore_backward(const int *, const int *, int);
+
+int *plan_route(int, int);
+
+void push_block(block_ring_t *, output_block_t *);
+
+output_block_t *pop_block(block_ring_t *);
+
+void write_blocks(output_block_t **, int);
+
+void *write_behind(void *);
+
+void start_writer();
+
+void stop_writer();
+
+void flush_output();
+
+void reserve_output(long);
+
+void write_int(int);
+
+void write_varint(int);
+
+void print_response(int);
+
+void print_route(const int *);
+
+void execute_add_station(const int *, int);
+
+void execute_add_car(const int *, int);
+
+void execute_remove_car(const int *, int);
+
+void execute_remove_station(const int *, int);
+
+void execute_plan_route(const int *, int);
+
+void init_commands();
+
+const command_t *get_command(const char *, int);
+
+int next_byte();
+
+int read_varint(int *);
+
+int detect_binary_input();
+
+void play_binary();
+
+int next_window(char **, char **, const char **);
+
+void *parse_segment(void *);
+
+void start_parsers(parse_job_t *, char *, char *, const char *);
+
+void join_parsers(parse_job_t *);
+
+void free_parsers(parse_job_t *);
+
+void play_decoded(parse_job_t *);
+
+void play_parallel();
+
+void play();
+
+/*** FUNCTION DEFINITION ***/
+
+/**
+ * @brief opens the input of the program.
+ * regular files are memory mapped, so that the commands can be read directly from the mapping
+ * without copying them; pipes, terminals and compressed files are read ahead in chunks by a reader thread,
+ * which also decompresses them.
+ *
+ * @param path the path of the file to read the commands from, or NULL to read from stdin.
+ * @return int 0 if the input has been opened successfully, -1 otherwise.
+ */
+int open_input(const char *path) {
+  int fd = path != NULL ? open(path, O_RDONLY) : STDIN_FILENO;
+  if (fd == -1)
+    return -1;
+
+  struct stat info;
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+    void *map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) {
+      // the file is read from start to end only once
+      madvise(map, info.st_size, MADV_SEQUENTIAL);
+
+      // the mapping stays valid after the file has been closed
+      if (fd != STDIN_FILENO)
+        close(fd);
+
+      input_compression = detect_compression((unsigned char *) map, info.st_size);
+      if (input_compression == no_compression) {
+        input_map = (char *) map;
+        input_cursor = input_map;
+        input_end = input_map + info.st_size;
+        input_readable_end = input_end;
+        return 0;
+      }
+
+      // a compressed file is decompressed by the reader, straight from the mapping
+      raw_input = (unsigned char *) map;
+      raw_length = info.st_size;
+      raw_mapped = true;
+      fd = -1;
+    }
+  }
+
+  // the input cannot be mapped, so it gets read ahead while the commands are played
+  input_fd = fd;
+  for (int i = 0; i < number_of_chunks; i++) {
+    chunks[i].data = (char *) malloc(chunk_size);
+    chunks[i].capacity = chunk_size;
+    chunks[i].state = chunk_free;
+  }
+
+  if (pthread_create(&reader, NULL, read_ahead, NULL) != 0)
+    return -1;
+
+  // the reader ends by itself after the last chunk, and nobody waits for it
+  pthread_detach(reader);
+  return 0;
+}
+
+/**
+ * @brief detects the compression of the input from its magic bytes.
+ *
+ * @param data the first bytes of the input.
+ * @param length the number of bytes.
+ * @return compression_t the compression of the input.
+ */
+compression_t detect_compression(const unsigned char *data, long length) {
+  if (length >= 2 && data[0] == 0x1F && data[1] == 0x8B)
+    return gzip_compression;
+  if (length >= 4 && data[0] == 0x28 && data[1] == 0xB5 && data[2] == 0x2F && data[3] == 0xFD)
+    return zstd_compression;
+
+  return no_compression;
+}
+
+/**
+ * @brief initializes the decompression of the input.
+ *
+ * @return int 1 if the input can be decompressed, 0 if this build does not support its compression.
+ */
+int init_decompression() {
+  switch (input_compression) {
+    case no_compression:
+      return 1;
+    case gzip_compression:
+#ifdef have_zlib
+      // accepts only the gzip header
+      return inflateInit2(&gzip_stream, 16 + MAX_WBITS) == Z_OK;
+#else
+      return 0;
+#endif
+    case zstd_compression:
+#ifdef have_zstd
+      zstd_stream = ZSTD_createDStream();
+      return zstd_stream != NULL && !ZSTD_isError(ZSTD_initDStream(zstd_stream));
+#else
+      return 0;
+#endif
+  }
+
+  return 0;
+}
+
+/**
+ * @brief reads the next raw bytes of the input, once the previous ones have all been decompressed.
+ *
+ * a pipe blocks here until its writer sends more bytes or closes it.
+ *
+ * @return int 1 if there are raw bytes to be decompressed, 0 only if the input is over.
+ */
+int fill_raw() {
+  if (raw_position < raw_length)
+    return 1;
+  if (raw_mapped)
+    return 0;
+
+  ssize_t count;
+  do
+    count = read(input_fd, raw_input, raw_size);
+  while (count < 0 && errno == EINTR);
+
+  raw_position = 0;
+  raw_length = count > 0 ? count : 0;
+  return raw_length > 0;
+}
+
+/**
+ * @brief reads the next bytes of the input, decompressing them if needed.
+ *
+ * @param destination where to write the bytes.
+ * @param capacity the maximum number of bytes to write.
+ * @return long the number of bytes written, 0 if the input is over.
+ */
+long read_input(char *destination, long capacity) {
+  if (input_compression == no_compression) {
+    // gives first the bytes read to detect the compression
+    if (raw_position < raw_length) {
+      long count = raw_length - raw_position < capacity ? raw_length - raw_position : capacity;
+      memcpy(destination, raw_input + raw_position, count);
+      raw_position += count;
+      return count;
+    }
+
+    ssize_t count;
+    do
+      count = read(input_fd, destination, capacity);
+    while (count < 0 && errno == EINTR);
+
+    return count > 0 ? count : 0;
+  }
+
+#ifdef have_zlib
+  if (input_compression == gzip_compression) {
+    gzip_stream.next_out = (Bytef *) destination;
+    gzip_stream.avail_out = (uInt) capacity;
+
+    while (gzip_stream.avail_out > 0) {
+      boolean more = fill_raw();
+      // a mapped file can be larger than what zlib takes in a single call
+      long available = raw_length - raw_position;
+      gzip_stream.next_in = raw_input + raw_position;
+      gzip_stream.avail_in = (uInt) (available < (1L << 30) ? available : 1L << 30);
+
+      uInt before = gzip_stream.avail_out;
+      int result = inflate(&gzip_stream, Z_NO_FLUSH);
+      raw_position = (long) (gzip_stream.next_in - raw_input);
+
+      if (result == Z_STREAM_END) {
+        // the input can be made of many gzip members, one after the other
+        if (!fill_raw())
+          break;
+        inflateReset(&gzip_stream);
+        continue;
+      }
+
+      if (result != Z_OK && result != Z_BUF_ERROR) {
+        fprintf(stderr, "corrupted gzip input\n");
+        break;
+      }
+
+      // the input is over and nothing is left to be flushed: having used all the bytes received so far
+      // is not enough, since a slow pipe may still send more
+      if (gzip_stream.avail_out == before && !more)
+        break;
+    }
+
+    return capacity - gzip_stream.avail_out;
+  }
+#endif
+
+#ifdef have_zstd
+  if (input_compression == zstd_compression) {
+    ZSTD_outBuffer out = {destination, capacity, 0};
+
+    while (out.pos < out.size) {
+      boolean more = fill_raw();
+      ZSTD_inBuffer in = {raw_input + raw_position, raw_length - raw_position, 0};
+
+      size_t before = out.pos;
+      size_t result = ZSTD_decompressStream(zstd_stream, &out, &in);
+      raw_position += (long) in.pos;
+
+      if (ZSTD_isError(result)) {
+        fprintf(stderr, "corrupted zstd input: %s\n", ZSTD_getErrorName(result));
+        break;
+      }
+
+      // the input is over and nothing is left to be flushed, as for gzip
+      if (out.pos == before && !more)
+        break;
+    }
+
+    return (long) out.pos;
+  }
+#endif
+
+  return 0;
+}
+
+/**
+ * @brief reads the input in the chunks, in order, while the player plays the previous ones.
+ * every chunk ends with a whole line: the partial line at its end is moved to the next chunk,
+ * which grows if a single line does not fit in it.
+ *
+ * @param unused the argument of the thread.
+ * @return void* NULL.
+ */
+void *read_ahead(void *unused) {
+  chunk_t *previous = NULL;
+
+  // reads the first bytes of a stream to detect its compression
+  if (!raw_mapped) {
+    raw_input = (unsigned char *) malloc(raw_size);
+    while (raw_length < 4) {
+      ssize_t count = read(input_fd, raw_input + raw_length, raw_size - raw_length);
+      if (count < 0 && errno == EINTR)
+        continue;
+      if (count <= 0)
+        break;
+      raw_length += count;
+    }
+
+    input_compression = detect_compression(raw_input, raw_length);
+  }
+
+  if (!init_decompression()) {
+    fprintf(stderr, "compressed input not supported by this build\n");
+    exit(1);
+  }
+
+  for (int i = 0; true; i = (i + 1) % number_of_chunks) {
+    chunk_t *chunk = &chunks[i];
+
+    // waits for the player to give back the chunk
+    pthread_mutex_lock(&chunks_lock);
+    while (chunk->state != chunk_free)
+      pthread_cond_wait(&chunks_changed, &chunks_lock);
+    pthread_mutex_unlock(&chunks_lock);
+
+    // moves the partial line at the end of the previous chunk to the start of this one
+    long size = 0;
+    if (previous != NULL) {
+      size = previous->size - previous->length;
+      while (size > chunk->capacity / 2) {
+        chunk->capacity *= 2;
+        chunk->data = (char *) realloc(chunk->data, chunk->capacity);
+      }
+      memcpy(chunk->data, previous->data + previous->length, size);
+    }
+
+    chunk->last = false;
+    while (true) {
+      // fills the chunk
+      while (size < chunk->capacity) {
+        long count = read_input(chunk->data + size, chunk->capacity - size);
+        if (count == 0) {
+          chunk->last = true;
+          break;
+        }
+        size += count;
+      }
+
+      // the last chunk keeps its partial line, if any
+      chunk->length = size;
+      if (chunk->last || !atomic_load(&whole_lines))
+        break;
+
+      // finds the end of the last whole line
+      while (chunk->length > 0 && chunk->data[chunk->length - 1] != '\n')
+        chunk->length--;
+      if (chunk->length > 0)
+        break;
+
+      // the line is longer than the chunk, so the chunk grows to contain it
+      chunk->capacity *= 2;
+      chunk->data = (char *) realloc(chunk->data, chunk->capacity);
+    }
+    chunk->size = size;
+
+    // gives the chunk to the player
+    pthread_mutex_lock(&chunks_lock);
+    chunk->state = chunk_ready;
+    pthread_cond_broadcast(&chunks_changed);
+    pthread_mutex_unlock(&chunks_lock);
+
+    if (chunk->last)
+      return NULL;
+    previous = chunk;
+  }
+}
+
+/**
+ * @brief gives the chunk being played back to the reader, and moves the input to the next one.
+ *
+ * @return int 1 if the input moved to the next chunk, 0 if there are no more chunks.
+ */
+int next_chunk() {
+  // the memory mapped input is made of a single chunk
+  if (input_map != NULL || (playing_chunk != -1 && chunks[playing_chunk].last))
+    return 0;
+
+  pthread_mutex_lock(&chunks_lock);
+  if (playing_chunk != -1)
+    chunks[playing_chunk].state = chunk_free;
+
+  playing_chunk = (playing_chunk + 1) % number_of_chunks;
+  chunk_t *chunk = &chunks[playing_chunk];
+
+  pthread_cond_broadcast(&chunks_changed);
+  while (chunk->state != chunk_ready)
+    pthread_cond_wait(&chunks_changed, &chunks_lock);
+  chunk->state = chunk_playing;
+  pthread_mutex_unlock(&chunks_lock);
+
+  input_cursor = chunk->data;
+  input_end = chunk->data + chunk->length;
+  input_readable_end = chunk->data + chunk->capacity;
+  return 1;
+}
+
+/**
+ * @brief grows the line buffer, if needed, to hold a line of the given length.
+ *
+ * @param length the number of chars of the line, including its new line.
+ */
+void ensure_line_buffer(long length) {
+  // leaves room for the terminator and for the reads of the scanner past the line
+  if (length + 16 <= line_buffer_capacity)
+    return;
+
+  line_buffer_capacity = length + 16 > buffer_size ? length + 16 : buffer_size;
+  line_buffer = (char *) realloc(line_buffer, line_buffer_capacity);
+}
+
+/**
+ * @brief moves the input buffer to the next line of the input.
+ *
+ * @return int 1 if a line has been read, 0 if there are no more lines.
+ */
+int next_line() {
+  while (input_cursor >= input_end)
+    if (!next_chunk())
+      return 0;
+
+  char *new_line = memchr(input_cursor, '\n', input_end - input_cursor);
+  if (new_line == NULL) {
+    // the last line of the input has no trailing new line: copies it in the line buffer,
+    // terminating it, so that no token can be read past the end of the input
+    long length = input_end - input_cursor;
+    ensure_line_buffer(length + 1);
+
+    buffer = line_buffer;
+    memcpy(buffer, input_cursor, length);
+    buffer[length] = '\n';
+    buffer[length + 1] = '\0';
+    line_end = buffer + length + 1;
+    input_limit = line_buffer + line_buffer_capacity;
+    input_cursor = input_end;
+    return 1;
+  }
+
+  // the line is read in place
+  buffer = input_cursor;
+  line_end = new_line + 1;
+  input_limit = input_readable_end;
+  input_cursor = new_line + 1;
+  return 1;
+}
+
+/**
+ * @brief finds the first delimiter (a space or a new line) in a line, starting from the given position.
+ *
+ * @param p the position from where to begin the search.
+ * @param end the end of the line.
+ * @param limit the end of the memory that can be safely read past the line.
+ * @return char* the position of the delimiter, or the end of the line if none is found.
+ */
+char *find_delimiter(char *p, const char *end, const char *limit) {
+#ifdef __SSE2__
+  // compares 16 chars at a time against both delimiters
+  const __m128i space = _mm_set1_epi8(' '), new_line = _mm_set1_epi8('\n');
+  while (p < end && p + 16 <= limit) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *) p);
+    int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, new_line)));
+    if (mask != 0) {
+      p += __builtin_ctz(mask);
+      return p < end ? p : (char *) end;
+    }
+    p += 16;
+  }
+#endif
+
+  while (p < end && *p != ' ' && *p != '\n')
+    p++;
+
+  return p;
+}
+
+/**
+ * @brief converts the given decimal digits to an unsigned integer, eight digits at a time,
+ * using SWAR (SIMD within a register) arithmetic.
+ *
+ * @param digits the digits to convert, followed by at least 8 - count readable chars.
+ * @param count the number of digits to convert, between 1 and 8.
+ * @return unsigned the converted integer.
+ */
+unsigned parse_digits(const char *digits, int count) {
+  uint64_t value;
+  memcpy(&value, digits, sizeof(value));
+
+  // drops the chars after the digits, which become leading zeros
+  value <<= 8 * (8 - count);
+
+  // sums adjacent digits, then adjacent pairs, then adjacent quadruples
+  value = ((value & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+  value = ((value & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+  return (unsigned) (((value & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32);
+}
+
+/**
+ * @brief grows the fields array of the given scanner.
+ *
+ * @param scanner the scanner.
+ */
+void grow_fields(scanner_t *scanner) {
+  scanner->capacity = scanner->capacity == 0 ? 2 + max_cars : scanner->capacity * 2;
+  scanner->fields = (int *) realloc(scanner->fields, sizeof(int) * scanner->capacity);
+}
+
+/**
+ * @brief scans a line in a single pass.
+ * it reads the command, then parses all the following unsigned decimal fields, appending them to the fields array.
+ *
+ * @param scanner the scanner where to append the fields.
+ * @param line the start of the line.
+ * @param end the end of the line: either its new line is before it, or no digit is after it.
+ * @param limit the end of the memory that can be safely read past the line.
+ * @param length where to store the number of chars of the command.
+ * @return char* the start of the command, or NULL if the line is empty.
+ */
+char *scan_line(scanner_t *scanner, char *line, char *end, const char *limit, int *length) {
+  char *command = line;
+  char *p = find_delimiter(line, end, limit);
+
+  *length = (int) (p - command);
+  // if no other chars available
+  if (*length == 0)
+    return NULL;
+
+  while (p < end) {
+    // skips the delimiters between the fields
+    if (*p == ' ') {
+      p++;
+      continue;
+    }
+    if (*p == '\n')
+      break;
+
+    // grows the fields array if needed
+    if (scanner->number_of_fields == scanner->capacity)
+      grow_fields(scanner);
+
+    unsigned value = 0;
+#if defined(__SSE2__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (p + 16 <= limit) {
+      // finds the number of consecutive digits of the field, 16 chars at a time
+      __m128i chunk = _mm_loadu_si128((const __m128i *) p);
+      __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('0' - 1)),
+                                       _mm_cmplt_epi8(chunk, _mm_set1_epi8('9' + 1)));
+      int count = __builtin_ctz(~_mm_movemask_epi8(is_digit));
+
+      if (count > 8)
+        value = parse_digits(p, count - 8) * 100000000u + parse_digits(p + count - 8, 8);
+      else if (count > 0)
+        value = parse_digits(p, count);
+
+      p += count;
+    } else
+#endif
+      while (p < end && (unsigned) (*p - '0') < 10)
+        value = value * 10 + (*p++ - '0');
+
+    // ignores whatever follows the digits up to the next delimiter, as atoi did
+    if (p < end && *p != ' ' && *p != '\n')
+      p = find_delimiter(p, end, limit);
+
+    scanner->fields[scanner->number_of_fields++] = (int) value;
+  }
+
+  return command;
+}
+
+/**
+ * @brief swaps the elements at the given indexes of the given array.
+ *
+ * @param arr the array to swap the elements in.
+ * @param i the first index.
+ * @param j the second index.
+ */
+void swap(int *arr, int i, int j) {
+  int temp = arr[i];
+  arr[i] = arr[j];
+  arr[j] = temp;
+}
+
+/**
+ * @brief moves the element at the given index of a max heap up, until its parent is not smaller.
+ *
+ * @param heap the heap.
+ * @param i the index of the element.
+ */
+void sift_up(int *heap, int i) {
+  int value = heap[i];
+  while (i > 0 && heap[(i - 1) / 2] < value) {
+    heap[i] = heap[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+
+  heap[i] = value;
+}
+
+/**
+ * @brief moves the element at the given index of a max heap down, until its children are not greater.
+ *
+ * @param heap the heap.
+ * @param length the number of elements of the heap.
+ * @param i the index of the element.
+ */
+void sift_down(int *heap, int length, int i) {
+  int value = heap[i];
+  while (2 * i + 1 < length) {
+    // the greater child
+    int child = 2 * i + 1;
+    if (child + 1 < length && heap[child + 1] > heap[child])
+      child++;
+
+    if (heap[child] <= value)
+      break;
+
+    heap[i] = heap[child];
+    i = child;
+  }
+
+  heap[i] = value;
+}
+
+/**
+ * @brief searches the car with the given range in the given station.
+ *
+ * @param station the station where to search for the car.
+ * @param range the range of the car to search.
+ * @return int the index at which the car == found, -1 if no car == found.
+ */
+int contains_car(station_t *station, int range) {
+  // the cars form a max heap, so no car can have a range greater than the first one
+  if (station == NULL || station == null_station || station->number_of_cars == 0 || range > station->cars[0])
+    return -1;
+
+  const int *cars = station->cars;
+  int i = 0;
+
+#ifdef __SSE2__
+  // compares 4 cars at a time
+  const __m128i key = _mm_set1_epi32(range);
+  for (; i + 4 <= station->number_of_cars; i += 4) {
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) &cars[i]), key));
+    if (mask != 0)
+      return i + __builtin_ctz(mask) / 4;
+  }
+#endif
+
+  for (; i < station->number_of_cars; i++)
+    if (cars[i] == range)
+      return i;
+
+  // no car found
+  return -1;
+}
+
+/**
+ * @brief reserves the address space of the arena, aligned to a huge page, and asks for it to be backed by huge pages.
+ * if they are not available the arena simply uses normal pages.
+ *
+ * @return true if the arena has been reserved.
+ * @return false otherwise.
+ */
+boolean reserve_arena() {
+  // only reserves the address space: the memory is committed one slab at a time.
+  // the reservation still counts against a limited address space, so it leaves half of it to the rest of the program
+  size_t size = arena_size;
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_AS, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY && size > limit.rlim_cur / 2)
+    size = limit.rlim_cur / 2;
+
+  // one more slab leaves room to align the arena
+  size *= 2;
+  char *region;
+  do {
+    size /= 2;
+    region = (char *) mmap(NULL, size + slab_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  } while (region == MAP_FAILED && size > slab_size);
+  if (region == MAP_FAILED)
+    return false;
+
+  arena = (char *) (((uintptr_t) region + slab_size - 1) & ~((uintptr_t) slab_size - 1));
+  arena_cursor = arena;
+  arena_end = arena + size;
+
+#ifdef MADV_HUGEPAGE
+  // fails without transparent huge pages, leaving the normal pages
+  madvise(arena, size, MADV_HUGEPAGE);
+#endif
+  return true;
+}
+
+/**
+ * @brief commits the next slab of the arena, reserving the arena the first time.
+ *
+ * @return char* the slab, or NULL if the arena is full or no memory is available.
+ */
+char *new_slab() {
+  if (arena == NULL && !reserve_arena())
+    return NULL;
+
+  if (arena_end - arena_cursor < slab_size || mprotect(arena_cursor, slab_size, PROT_READ | PROT_WRITE) != 0)
+    return NULL;
+
+  char *slab = arena_cursor;
+  arena_cursor += slab_size;
+  return slab;
+}
+
+/**
+ * @brief measures the memory of the arena backed by huge pages, as reported by the kernel.
+ *
+ * @return long the memory backed by huge pages in kB, or -1 if it cannot be measured.
+ */
+long huge_page_memory() {
+  FILE *smaps = fopen("/proc/self/smaps", "r");
+  if (smaps == NULL)
+    return -1;
+
+  long total = 0;
+  boolean in_arena = false;
+  char line[256];
+  while (fgets(line, sizeof(line), smaps) != NULL) {
+    unsigned long start, end;
+    long size;
+
+    // every mapping starts with its address range, followed by its counters
+    if (sscanf(line, "%lx-%lx ", &start, &end) == 2)
+      in_arena = start >= (uintptr_t) arena && end <= (uintptr_t) arena_end;
+    else if (in_arena && sscanf(line, "AnonHugePages: %ld kB", &size) == 1)
+      total += size;
+  }
+
+  fclose(smaps);
+  return total;
+}
+
+/**
+ * @brief allocates an object from the given pool, reusing the last freed one if any.
+ *
+ * @param pool the pool.
+ * @return void* the object, or NULL if no memory is available.
+ */
+void *pool_alloc(pool_t *pool) {
+  void *object = pool->free_list;
+  if (object != NULL) {
+    pool->free_list = *(void **) object;
+    return object;
+  }
+
+  // carves the objects out of a new slab, so that the ones allocated together sit next to each other
+  if (pool->slab_cursor == pool->slab_end) {
+    pool->slab_cursor = new_slab();
+    if (pool->slab_cursor == NULL) {
+      pool->slab_end = NULL;
+      return NULL;
+    }
+    pool->slab_end = pool->slab_cursor + slab_size / pool->object_size * pool->object_size;
+  }
+
+  object = pool->slab_cursor;
+  pool->slab_cursor += pool->object_size;
+  return object;
+}
+
+/**
+ * @brief gives an object back to its pool. the slabs are never released.
+ *
+ * @param pool the pool.
+ * @param object the object.
+ */
+void pool_free(pool_t *pool, void *object) {
+  *(void **) object = pool->free_list;
+  pool->free_list = object;
+}
+
+/**
+ * @brief allocates memory and initializes a new station at the given distance.
+ *
+ * @param distance the distance where to put the station.
+ * @return station_t* the newly created station.
+ */
+station_t *init_station(int distance) {
+  station_t *new_station = (station_t *) pool_alloc(&station_pool);
+
+  if (new_station != NULL) {
+    // initializes the distance field with the given distance,
+    // and all the other fields to default values
+    new_station->distance = distance;
+#if station_index == rb_tree_index
+    // all the links point to the null station, which is black
+    new_station->left = 0;
+    new_station->right = 0;
+    new_station->parent = color_bit;
+    new_station->previous = 0;
+    new_station->next = 0;
+#elif station_index == bplus_tree_index
+    new_station->leaf = NULL;
+#endif
+    // the cars are stored inside the station, all initialized to 0, until they outgrow it
+    new_station->cars = new_station->local_cars;
+    new_station->car_capacity = inline_cars;
+    memset(new_station->local_cars, 0, sizeof(new_station->local_cars));
+    new_station->max_range = 0;
+    new_station->number_of_cars = 0;
+
+    return new_station;
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief gives the memory of the given station back to the pools.
+ *
+ * @param station the station.
+ */
+void free_station(station_t *station) {
+  if (station->cars != station->local_cars)
+    pool_free(&car_pools[car_pool_of(station->car_capacity)], station->cars);
+  pool_free(&station_pool, station);
+}
+
+/**
+ * @brief doubles the capacity of the cars array of the given station.
+ *
+ * @param station the station.
+ * @return true if the array has grown.
+ * @return false if no memory is available, leaving the cars as they were.
+ */
+boolean grow_cars(station_t *station) {
+  int capacity = station->car_capacity * 2;
+  int *cars = (int *) pool_alloc(&car_pools[car_pool_of(capacity)]);
+  if (cars == NULL)
+    return false;
+
+  memcpy(cars, station->cars, sizeof(int) * station->number_of_cars);
+
+  if (station->cars != station->local_cars)
+    pool_free(&car_pools[car_pool_of(station->car_capacity)], station->cars);
+
+  station->cars = cars;
+  station->car_capacity = capacity;
+  return true;
+}
+
+/**
+ * @brief sets the maximum range of the cars of the given station.
+ *
+ * @param station the station.
+ * @param max_range the maximum range of its cars.
+ */
+void set_max_range(station_t *station, int max_range) {
+  station->max_range = max_range;
+  invalidate_routes(station->distance);
+
+#if station_index == bplus_tree_index
+  // the leaf keeps a copy of the maximum range next to the distance, for the planner
+  leaf_t *leaf = station->leaf;
+  leaf->max_ranges[search_leaf(leaf, station->distance)] = max_range;
+#elif station_index == sorted_arrays_index
+  hot_ranges[search_hot(station->distance)] = max_range;
+#elif station_index == persistent_tree_index
+  // the range is part of the versions, so a new one is published
+  publish_version(update_version(current_version, station->distance, max_range));
+#endif
+}
+
+/**
+ * @brief grows the window arrays, if needed, to hold all the stations of the route.
+ */
+void ensure_window() {
+  if (number_of_stations <= window_capacity)
+    return;
+
+  window_capacity = number_of_stations * 2;
+  window_distances = (int *) realloc(window_distances, sizeof(int) * window_capacity);
+  window_ranges = (int *) realloc(window_ranges, sizeof(int) * window_capacity);
+}
+
+/**
+ * @brief gets the station at the given distance from the hash table.
+ *
+ * @param distance the distance at where the station should be found.
+ * @return station_t* the found station, or the null station if none is found.
+ */
+station_t *get_from_table(int distance) {
+  if (station_table == NULL)
+    return null_station;
+
+  // the stations that collide are stored in the following slots, up to the first empty one
+  for (unsigned i = hash_distance(distance, table_capacity); station_table[i].station != NULL;
+       i = (i + 1) & (table_capacity - 1))
+    if (station_table[i].distance == distance)
+      return station_table[i].station;
+
+  return null_station;
+}
+
+/**
+ * @brief doubles the capacity of the hash table, placing the stations again.
+ */
+void grow_table() {
+  station_slot_t *old_table = station_table;
+  int old_capacity = table_capacity;
+
+  table_capacity = old_capacity == 0 ? initial_table_capacity : old_capacity * 2;
+  station_table = (station_slot_t *) calloc(table_capacity, sizeof(station_slot_t));
+
+  for (int i = 0; i < old_capacity; i++)
+    if (old_table[i].station != NULL)
+      add_to_table(old_table[i].station);
+
+  free(old_table);
+}
+
+/**
+ * @brief adds the given station to the hash table, which must not contain its distance yet.
+ *
+ * @param station the station to add.
+ */
+void add_to_table(station_t *station) {
+  // keeps the table at most half full, so that the probe sequences stay short
+  if (2 * (number_of_stations + 1) > table_capacity)
+    grow_table();
+
+  unsigned i = hash_distance(station->distance, table_capacity);
+  while (station_table[i].station != NULL)
+    i = (i + 1) & (table_capacity - 1);
+
+  station_table[i].distance = station->distance;
+  station_table[i].station = station;
+}
+
+/**
+ * @brief removes the station at the given distance from the hash table.
+ *
+ * @param distance the distance of the station to remove.
+ */
+void remove_from_table(int distance) {
+  if (station_table == NULL)
+    return;
+
+  unsigned mask = table_capacity - 1;
+  unsigned i = hash_distance(distance, table_capacity);
+  while (station_table[i].station != NULL && station_table[i].distance != distance)
+    i = (i + 1) & mask;
+  if (station_table[i].station == NULL)
+    return;
+
+  // moves back the following stations of the probe sequence that would not be found past the emptied slot,
+  // so that no tombstones are needed
+  unsigned j = i;
+  while (true) {
+    station_table[i].station = NULL;
+
+    do {
+      j = (j + 1) & mask;
+      if (station_table[j].station == NULL)
+        return;
+    } while (((j - hash_distance(station_table[j].distance, table_capacity)) & mask) <
+             ((j - i) & mask));
+
+    station_table[i] = station_table[j];
+    i = j;
+  }
+}
+
+/**
+ * @brief prefetches the slot of the hash table where the station at the given distance is searched first.
+ *
+ * @param distance the distance of the station.
+ */
+void prefetch_slot(int distance) {
+  if (station_table != NULL)
+    __builtin_prefetch(&station_table[hash_distance(distance, table_capacity)]);
+}
+
+/**
+ * @brief prefetches the station at the given distance, if it is in the first slot where it is searched.
+ * the slot should have been prefetched some time before, so that reading it does not stall.
+ *
+ * @param distance the distance of the station.
+ */
+void prefetch_station(int distance) {
+  if (station_table == NULL)
+    return;
+
+  const station_slot_t *slot = &station_table[hash_distance(distance, table_capacity)];
+  if (slot->station != NULL && slot->distance == distance)
+    __builtin_prefetch(slot->station, 1);
+}
+
+/**
+ * @brief allocates the station cache.
+ *
+ * @param size the minimum number of stations the cache can hold, or 0 to disable it.
+ */
+void init_cache(int size) {
+  if (size <= 0)
+    return;
+
+  cache_sets = 1;
+  while (cache_sets * cache_ways < size)
+    cache_sets *= 2;
+
+  station_cache = (station_slot_t *) calloc(cache_sets * cache_ways, sizeof(station_slot_t));
+}
+
+/**
+ * @brief caches the given station as the most recently used of its set, evicting the least recently used one.
+ *
+ * @param station the station, which must not be in the cache.
+ */
+void cache_station(station_t *station) {
+  if (cache_sets == 0)
+    return;
+
+  station_slot_t *set = &station_cache[hash_distance(station->distance, cache_sets) * cache_ways];
+  memmove(&set[1], &set[0], sizeof(station_slot_t) * (cache_ways - 1));
+  set[0].distance = station->distance;
+  set[0].station = station;
+}
+
+/**
+ * @brief gets the station at the given distance, from the cache if possible, caching it otherwise.
+ *
+ * @param distance the distance at where the station should be found.
+ * @return station_t* the found station, or the null station if none is found.
+ */
+station_t *get_cached(int distance) {
+  if (cache_sets > 0) {
+    station_slot_t *set = &station_cache[hash_distance(distance, cache_sets) * cache_ways];
+    for (int i = 0; i < cache_ways && set[i].station != NULL; i++)
+      if (set[i].distance == distance) {
+        // moves the station to the front of its set
+        station_slot_t hit = set[i];
+        memmove(&set[1], &set[0], sizeof(station_slot_t) * i);
+        set[0] = hit;
+
+        cache_hits++;
+        return hit.station;
+      }
+  }
+
+  cache_misses++;
+  station_t *station = get_from_table(distance);
+  if (station != null_station)
+    cache_station(station);
+
+  return station;
+}
+
+/**
+ * @brief removes the station at the given distance from the cache, if present.
+ *
+ * @param distance the distance of the station.
+ */
+void uncache_station(int distance) {
+  if (cache_sets == 0)
+    return;
+
+  station_slot_t *set = &station_cache[hash_distance(distance, cache_sets) * cache_ways];
+  for (int i = 0; i < cache_ways && set[i].station != NULL; i++)
+    if (set[i].distance == distance) {
+      // moves the following stations forward, leaving the empty way at the end of the set
+      memmove(&set[i], &set[i + 1], sizeof(station_slot_t) * (cache_ways - 1 - i));
+      set[cache_ways - 1].station = NULL;
+      return;
+    }
+}
+
+/**
+ * @brief allocates the route cache.
+ *
+ * @param size the minimum number of routes the cache can hold, or 0 to disable it.
+ */
+void init_route_cache(int size) {
+  if (size <= 0)
+    return;
+
+  route_cache_size = 1;
+  while (route_cache_size < size)
+    route_cache_size *= 2;
+
+  route_cache = (route_entry_t *) calloc(route_cache_size, sizeof(route_entry_t));
+  changed_at = (unsigned long *) calloc(2 << route_bucket_bits, sizeof(unsigned long));
+}
+
+/**
+ * @brief makes the buckets of the route cache twice as wide, joining every pair of buckets in one:
+ * the last change of the new bucket is the last of the two, already held by their parent.
+ */
+void widen_route_buckets() {
+  int buckets = 1 << route_bucket_bits;
+  memcpy(&changed_at[buckets], &changed_at[buckets / 2], sizeof(unsigned long) * (buckets / 2));
+  memset(&changed_at[buckets + buckets / 2], 0, sizeof(unsigned long) * (buckets / 2));
+  for (int i = buckets - 1; i > 0; i--)
+    changed_at[i] = changed_at[2 * i] > changed_at[2 * i + 1] ? changed_at[2 * i] : changed_at[2 * i + 1];
+
+  route_shift++;
+}
+
+/**
+ * @brief records a change to the stations at the given distance, invalidating the routes across it.
+ *
+ * @param distance the distance of the change.
+ */
+void invalidate_routes(int distance) {
+  if (route_cache_size == 0)
+    return;
+
+  // a station beyond the last bucket makes the buckets wider, until they reach it
+  while (route_bucket(distance) >= 1 << route_bucket_bits)
+    widen_route_buckets();
+
+  // the clock only grows, so the change is the last one of every node above its bucket
+  route_clock++;
+  for (int i = (1 << route_bucket_bits) + route_bucket(distance); i > 0; i /= 2)
+    changed_at[i] = route_clock;
+}
+
+/**
+ * @brief gets the time of the last change to the stations between the given distances.
+ *
+ * @param from the minimum distance.
+ * @param to the maximum distance.
+ * @return unsigned long the time of the last change in the buckets of the distances.
+ */
+unsigned long last_change_between(int from, int to) {
+  unsigned long last = 0;
+
+  // climbs the tree from the two buckets, adding the nodes between them
+  int l = (1 << route_bucket_bits) + route_bucket(from),
+      r = (1 << route_bucket_bits) + route_bucket(to) + 1;
+  for (; l < r; l /= 2, r /= 2) {
+    if (l & 1)
+      last = changed_at[l] > last ? changed_at[l] : last, l++;
+    if (r & 1)
+      r--, last = changed_at[r] > last ? changed_at[r] : last;
+  }
+
+  return last;
+}
+
+/**
+ * @brief finds the route between the given distances in the route cache.
+ *
+ * @param distance1 the distance from which the route starts.
+ * @param distance2 the distance where the route ends.
+ * @return route_entry_t* the entry of the route, or NULL if the route is not remembered or has changed since.
+ */
+route_entry_t *find_route(int distance1, int distance2) {
+  if (route_cache_size == 0)
+    return NULL;
+
+  route_entry_t *entry = &route_cache[hash_route(distance1, distance2, route_cache_size)];
+  int from = distance1 < distance2 ? distance1 : distance2,
+      to = distance1 < distance2 ? distance2 : distance1;
+  if (entry->used && entry->distance1 == distance1 && entry->distance2 == distance2 &&
+      last_change_between(from, to) <= entry->planned_at) {
+    route_hits++;
+    return entry;
+  }
+
+  route_misses++;
+  return NULL;
+}
+
+/**
+ * @brief copies the given route.
+ *
+ * @param route the stops of the route, ended by -1.
+ * @return int* the copy.
+ */
+int *copy_route(const int *route) {
+  int length = 0;
+  while (route[length] != -1)
+    length++;
+
+  int *copy = (int *) malloc(sizeof(int) * (length + 1));
+  memcpy(copy, route, sizeof(int) * (length + 1));
+  return copy;
+}
+
+/**
+ * @brief remembers the route between the given distances, replacing the one in its entry.
+ *
+ * @param distance1 the distance from which the route starts.
+ * @param distance2 the distance where the route ends.
+ * @param route the stops of the route, ended by -1, or NULL if there is no route.
+ */
+void remember_route(int distance1, int distance2, const int *route) {
+  if (route_cache_size == 0)
+    return;
+
+  route_entry_t *entry = &route_cache[hash_route(distance1, distance2, route_cache_size)];
+  free(entry->route);
+  entry->distance1 = distance1;
+  entry->distance2 = distance2;
+  entry->planned_at = route_clock;
+  entry->route = route != NULL ? copy_route(route) : NULL;
+  entry->used = true;
+}
+
+#if station_index == rb_tree_index
+/**
+ * @brief gets the station at the given distance.
+ * * DO NOT TOUCH! From Cormen book
+ *
+ * @param distance the distance at where the station should be found.
+ * @return station_t* the found station, or NULL if none == found.
+ */
+station_t *get_at(int distance) {
+  station_t *x = root;
+  while (x != NULL && x != null_station && x->distance != distance) {
+    if (distance < x->distance)
+      x = left_of(x);
+    else
+      x = right_of(x);
+  }
+
+  // the route may have no stations at all
+  return x != NULL ? x : null_station;
+}
+
+/**
+ * @brief gets the station with the minimum distance from the given station.
+ * * DO NOT TOUCH! From Cormen book
+ *
+ * @param x the station from where to begin the search.
+ * @return station_t* the station with the minimum distance.
+ */
+station_t *get_minimum(station_t *x) {
+  if (x == NULL || x == null_station)
+    return null_station;
+
+  while (left_of(x) != null_station)
+    x = left_of(x);
+
+  return x;
+}
+
+/**
+ * @brief gets the station with the maximum distance from the given station.
+ * * DO NOT TOUCH! From Cormen book
+ *
+ * @param x the station from where to begin the search.
+ * @return station_t* the station with the maximum distance.
+ */
+station_t *get_maximum(station_t *x) {
+  if (x == NULL || x == null_station)
+    return null_station;
+
+  while (right_of(x) != null_station)
+    x = right_of(x);
+
+  return x;
+}
+
+/**
+ * @brief gets the station next to the given one in the route.
+ *
+ * @param station the station from where to begin the search.
+ * @return station_t* the next station.
+ */
+station_t *get_successor_of(station_t *x) {
+  if (x == null_station)
+    return null_station;
+
+  return station_at(x->next);
+}
+
+/**
+ * @brief rotates the sub tree with the given root to the left.
+ * * DO NOT TOUCH! From Cormen book
+ *
+ * @param x the root of the sub tree to rotate.
+ */
+void left_rotate(station_t *x) {
+  if (right_of(x) == null_station)
+    return;
+
+  station_t *y = right_of(x);
+  x->right = y->left;
+
+  if (left_of(y) != null_station)
+    set_parent(left_of(y), x);
+  set_parent(y, parent_of(x));
+
+  if (parent_of(x) == null_station)
+    root = y;
+  else if (x == left_of(parent_of(x)))
+    set_left(parent_of(x), y);
+  else
+    set_right(parent_of(x), y);
+
+  set_left(y, x);
+  set_parent(x, y);
+}
+
+/**
+ * @brief rotates the sub tree with the given root to the right.
+ * * DO NOT TOUCH! From Cormen book
+ *
+ * @param x the root of the sub tree to rotate.
+ */
+void right_rotate(station_t *x) {
+  if (left_of(x) == null_station)
+    return;
+
+  station_t *y = left_of(x);
+  x->left = y->right;
+
+  if (right_of(y) != null_station)
+    set_parent(right_of(y), x);
+  set_parent(y, parent_of(x));
+
+  if (parent_of(x) == null_station)
+    root = y;
+  else if (x == right_of(parent_of(x)))
+    set_right(parent_of(x), y);
+  else
+    set_left(parent_of(x), y);
+
+  set_right(y, x);
+  set_parent(x, y);
+}
+
+/**
+ * @brief fixes the tree properties after an insertion.
+ * * DO NOT TOUCH! From Cormen book
+ *
+ * @param z the station that was inserted.
+ */
+void insert_fixup(station_t *z) {
+  station_t *y = NULL;
+
+  while (color_of(parent_of(z)) == red) {
+    if (parent_of(z) == left_of(parent_of(parent_of(z)))) {
+      y = right_of(parent_of(parent_of(z)));
+      if (color_of(y) == red) {
+        set_color(parent_of(z), black);
+        set_color(y, black);
+        set_color(parent_of(parent_of(z)), red);
+        z = parent_of(parent_of(z));
+      } else {
+        if (z == right_of(parent_of(z))) {
+          z = parent_of(z);
+          left_rotate(z);
+        }
+        set_color(parent_of(z), black);
+        set_color(parent_of(parent_of(z)), red);
+        right_rotate(parent_of(parent_of(z)));
+      }
+    } else {
+      y = left_of(parent_of(parent_of(z)));
+      if (color_of(y) == red) {
+        set_color(parent_of(z), black);
+        set_color(y, black);
+        set_color(parent_of(parent_of(z)), red);
+        z = parent_of(parent_of(z));
+      } else {
+        if (z == left_of(parent_of(z))) {
+          z = parent_of(z);
+          right_rotate(z);
+        }
+        set_color(parent_of(z), black);
+        set_color(parent_of(parent_of(z)), red);
+        left_rotate(parent_of(parent_of(z)));
+      }
+    }
+  }
+
+  set_color(root, black);
+}
+
+/**
+ * @brief fixes the tree properties after a deletion.
+ * * DO NOT TOUCH! From Cormen book
+ *
+ * @param z the station that was deleted.
+ */
+void delete_fixup(station_t *z) {
+  station_t *w = NULL;
+
+  if (z == NULL)
+    return;
+
+  while (z != root && color_of(z) == black) {
+    if (z == left_of(parent_of(z))) {
+      w = right_of(parent_of(z));
+
+      if (color_of(w) == red) {
+        set_color(w, black);
+        set_color(parent_of(z), red);
+        left_rotate(parent_of(z));
+        w = right_of(parent_of(z));
+      }
+
+      if (color_of(left_of(w)) == black && color_of(right_of(w)) == black) {
+        set_color(w, red);
+        z = parent_of(z);
+      } else {
+        if (color_of(right_of(w)) == black) {
+          set_color(left_of(w), black);
+          set_color(w, red);
+          right_rotate(w);
+          w = right_of(parent_of(z));
+        }
+
+        set_color(w, color_of(parent_of(z)));
+        set_color(parent_of(z), black);
+        set_color(right_of(w), black);
+        left_rotate(parent_of(z));
+        z = root;
+      }
+    } else {
+      w = left_of(parent_of(z));
+
+      if (color_of(w) == red) {
+        set_color(w, black);
+        set_color(parent_of(z), red);
+        right_rotate(parent_of(z));
+        w = left_of(parent_of(z));
+      }
+
+      if (color_of(right_of(w)) == black && color_of(left_of(w)) == black) {
+        set_color(w, red);
+        z = parent_of(z);
+      } else {
+        if (color_of(left_of(w)) == black) {
+          set_color(right_of(w), black);
+          set_color(w, red);
+          left_rotate(w);
+          w = left_of(parent_of(z));
+        }
+
+        set_color(w, color_of(parent_of(z)));
+        set_color(parent_of(z), black);
+        set_color(left_of(w), black);
+        right_rotate(parent_of(z));
+        z = root;
+      }
+    }
+  }
+
+  set_color(z, black);
+}
+
+/**
+ * @brief transplants the sub tree with root v in the sub tree with root u.
+ * * DO NOT TOUCH! From Cormen book
+ *
+ * @param u the root of the sub tree where to transplant.
+ * @param v the root of the sub tree to transplant.
+ */
+void transplant(station_t *u, station_t *v) {
+  if (parent_of(u) == null_station)
+    root = v;
+  else if (u == left_of(parent_of(u)))
+    set_left(parent_of(u), v);
+  else
+    set_right(parent_of(u), v);
+
+  set_parent(v, parent_of(u));
+}
+
+/**
+ * @brief adds the station at the given distance in the given route.
+ * * DO NOT TOUCH! From Cormen book
+ *
+ * @param distance the distance to add the station.
+ * @return station_t* the added station, or NULL if already present.
+ */
+station_t *add_station(int distance) {
+  station_t *y = null_station;
+  station_t *x = root;
+
+  while (x != NULL && x != null_station) {
+    // the station already exists
+    if (x->distance == distance)
+      return NULL;
+
+    y = x;
+    if (distance < x->distance)
+      x = left_of(x);
+    else
+      x = right_of(x);
+  }
+
+  station_t *z = init_station(distance);
+  if (z != NULL) {
+    set_parent(z, y);
+
+    // a new leaf is next to its parent in the order: before it if it is its left child, after it otherwise
+    if (y == null_station)
+      root = z;
+    else if (distance < y->distance) {
+      set_left(y, z);
+      z->previous = y->previous;
+      z->next = index_of(y);
+    } else {
+      set_right(y, z);
+      z->previous = index_of(y);
+      z->next = y->next;
+    }
+
+    if (z->previous != 0)
+      station_at(z->previous)->next = index_of(z);
+    if (z->next != 0)
+      station_at(z->next)->previous = index_of(z);
+
+    set_color(z, red);
+
+    insert_fixup(z);
+    add_to_table(z);
+    number_of_stations++;
+    return z;
+  }
+
+  return null_station;
+}
+
+/**
+ * @brief removes the station at the given distance in the given route.
+ * * DO NOT TOUCH! From Cormen book
+ *
+ * @param distance the distance to remove the station at.
+ * @return true if the station has been added successfully.
+ * @return false otherwise.
+ */
+boolean remove_station(int distance) {
+  station_t *z = get_from_table(distance);
+  if (z == null_station)
+    return false;
+
+  station_t *y = z;
+  station_t *x = NULL;
+  color_t color = color_of(y);
+
+  if (root == z && left_of(z) == null_station && right_of(z) == null_station) {
+    root = NULL;
+  } else if (left_of(z) == null_station) {
+    x = right_of(z);
+    transplant(z, right_of(z));
+  } else if (right_of(z) == null_station) {
+    x = left_of(z);
+    transplant(z, left_of(z));
+  } else {
+    y = station_at(z->next);
+    color = color_of(y);
+    x = right_of(y);
+
+    if (parent_of(y) == z)
+      set_parent(x, y);
+    else {
+      transplant(y, right_of(y));
+      y->right = z->right;
+      set_parent(right_of(y), y);
+    }
+
+    transplant(z, y);
+    y->left = z->left;
+    set_parent(left_of(y), y);
+    set_color(y, color_of(z));
+  }
+
+  if (color == black)
+    delete_fixup(x);
+
+  // unlinks the station from the order
+  if (z->previous != 0)
+    station_at(z->previous)->next = z->next;
+  if (z->next != 0)
+    station_at(z->next)->previous = z->previous;
+
+  free_station(z);
+  remove_from_table(distance);
+  number_of_stations--;
+  return true;
+}
+
+/**
+ * @brief copies the distances and the maximum ranges of the stations between the given distances in the window.
+ *
+ * @param from the distance of the first station, which must be in the route.
+ * @param to the maximum distance of the stations to copy.
+ * @return int the number of stations copied.
+ */
+int collect_stations(int from, int to) {
+  ensure_window();
+
+  int length = 0;
+  for (station_t *x = get_from_table(from); x != null_station && x->distance <= to; x = get_successor_of(x)) {
+    window_distances[length] = x->distance;
+    window_ranges[length++] = x->max_range;
+  }
+
+  return length;
+}
+
+/**
+ * @brief gets the minimum distance of the stations in the tree. the route must not be empty.
+ *
+ * @return int the minimum distance.
+ */
+int minimum_distance() {
+  return get_minimum(root)->distance;
+}
+
+/**
+ * @brief gets the maximum distance of the stations in the tree. the route must not be empty.
+ *
+ * @return int the maximum distance.
+ */
+int maximum_distance() {
+  return get_maximum(root)->distance;
+}
+#elif station_index == bplus_tree_index
+/**
+ * @brief searches the position of the given distance in the given leaf.
+ *
+ * @param leaf the leaf where to search.
+ * @param distance the distance to search.
+ * @return int the index of the first station of the leaf whose distance is not smaller than the given one.
+ */
+int search_leaf(const leaf_t *leaf, int distance) {
+  // binary search algorithm
+  int l = 0, r = leaf->number_of_stations;
+  while (l < r) {
+    int mid = (l + r) / 2;
+    if (leaf->distances[mid] < distance)
+      l = mid + 1;
+    else
+      r = mid;
+  }
+
+  return l;
+}
+
+/**
+ * @brief searches the child of the given inner node where the given distance can be stored.
+ *
+ * @param node the inner node where to search.
+ * @param distance the distance to search.
+ * @return int the index of the child.
+ */
+int search_inner(const inner_node_t *node, int distance) {
+  int i = 0;
+  while (i < node->number_of_keys && distance >= node->keys[i])
+    i++;
+
+  return i;
+}
+
+/**
+ * @brief finds the leaf where the given distance can be stored. the tree must not be empty.
+ *
+ * @param distance the distance to search.
+ * @return leaf_t* the leaf.
+ */
+leaf_t *find_leaf(int distance) {
+  void *node = root;
+  for (int level = tree_height; level > 0; level--) {
+    inner_node_t *inner = (inner_node_t *) node;
+    node = inner->children[search_inner(inner, distance)];
+  }
+
+  return (leaf_t *) node;
+}
+
+/**
+ * @brief gets the station at the given distance.
+ *
+ * @param distance the distance at where the station should be found.
+ * @return station_t* the found station, or the null station if none is found.
+ */
+station_t *get_at(int distance) {
+  if (root == NULL)
+    return null_station;
+
+  leaf_t *leaf = find_leaf(distance);
+  int i = search_leaf(leaf, distance);
+  if (i < leaf->number_of_stations && leaf->distances[i] == distance)
+    return leaf->stations[i];
+
+  return null_station;
+}
+
+/**
+ * @brief places the given station at the given index of a leaf that is not full, shifting the following ones.
+ *
+ * @param leaf the leaf where to place the station.
+ * @param i the index where to place the station.
+ * @param station the station to place.
+ */
+void place_station(leaf_t *leaf, int i, station_t *station) {
+  int following = leaf->number_of_stations - i;
+  memmove(&leaf->distances[i + 1], &leaf->distances[i], sizeof(int) * following);
+  memmove(&leaf->max_ranges[i + 1], &leaf->max_ranges[i], sizeof(int) * following);
+  memmove(&leaf->stations[i + 1], &leaf->stations[i], sizeof(station_t *) * following);
+
+  leaf->distances[i] = station->distance;
+  leaf->max_ranges[i] = station->max_range;
+  leaf->stations[i] = station;
+  leaf->number_of_stations++;
+  station->leaf = leaf;
+}
+
+/**
+ * @brief reserves the nodes that the insertion of a station at the given distance splits, before the tree changes.
+ *
+ * @param distance the distance of the station to insert.
+ * @param spares where to store the node reserved for every level, or NULL if the level is not split: the level
+ * above the root holds the new root.
+ * @return true if the nodes have been reserved.
+ * @return false if the memory is not enough, in which case nothing is reserved.
+ */
+boolean reserve_splits(int distance, void **spares) {
+  void *path[max_tree_height + 1];
+  void *node = root;
+  for (int level = tree_height; level > 0; level--) {
+    path[level] = node;
+    node = ((inner_node_t *) node)->children[search_inner((inner_node_t *) node, distance)];
+  }
+  path[0] = node;
+
+  for (int level = 0; level <= tree_height + 1; level++)
+    spares[level] = NULL;
+
+  // a node is split when it is full and the node below it has been split
+  boolean split = ((leaf_t *) path[0])->number_of_stations == leaf_order;
+  for (int level = 0; split; level++) {
+    spares[level] = calloc(1, level == 0 ? sizeof(leaf_t) : sizeof(inner_node_t));
+    if (spares[level] == NULL) {
+      for (int j = 0; j < level; j++)
+        free(spares[j]);
+      return false;
+    }
+
+    if (level < tree_height)
+      split = ((inner_node_t *) path[level + 1])->number_of_keys == inner_order - 1;
+    else
+      split = level == tree_height;
+  }
+
+  return true;
+}
+
+/**
+ * @brief inserts the given station in a leaf, splitting it in two if it is full.
+ *
+ * @param leaf the leaf where to insert the station.
+ * @param station the station to insert.
+ * @param spares the nodes reserved for the splits, by level.
+ * @param sibling where to store the new leaf following the given one, or NULL if the leaf has not been split.
+ * @return int the minimum distance of the new leaf, if any.
+ */
+int insert_into_leaf(leaf_t *leaf, station_t *station, void **spares, void **sibling) {
+  int i = search_leaf(leaf, station->distance);
+  if (leaf->number_of_stations < leaf_order) {
+    place_station(leaf, i, station);
+    *sibling = NULL;
+    return 0;
+  }
+
+  // moves the upper half of the stations to a new leaf, linked after the given one
+  leaf_t *right = (leaf_t *) spares[0];
+  int half = leaf_order / 2;
+  right->number_of_stations = leaf_order - half;
+  memcpy(right->distances, &leaf->distances[half], sizeof(int) * right->number_of_stations);
+  memcpy(right->max_ranges, &leaf->max_ranges[half], sizeof(int) * right->number_of_stations);
+  memcpy(right->stations, &leaf->stations[half], sizeof(station_t *) * right->number_of_stations);
+  for (int j = 0; j < right->number_of_stations; j++)
+    right->stations[j]->leaf = right;
+  leaf->number_of_stations = half;
+
+  right->previous = leaf;
+  right->next = leaf->next;
+  if (leaf->next != NULL)
+    leaf->next->previous = right;
+  leaf->next = right;
+
+  if (i <= half)
+    place_station(leaf, i, station);
+  else
+    place_station(right, i - half, station);
+
+  *sibling = right;
+  return right->distances[0];
+}
+
+/**
+ * @brief inserts the given station in the sub tree with the given root, splitting the nodes that overflow.
+ *
+ * @param node the root of the sub tree.
+ * @param level the height of the sub tree.
+ * @param station the station to insert.
+ * @param spares the nodes reserved for the splits, by level.
+ * @param sibling where to store the new node following the given one, or NULL if the node has not been split.
+ * @return int the minimum distance that can be stored under the new node, if any.
+ */
+int insert_into(void *node, int level, station_t *station, void **spares, void **sibling) {
+  if (level == 0)
+    return insert_into_leaf((leaf_t *) node, station, spares, sibling);
+
+  inner_node_t *inner = (inner_node_t *) node;
+  int i = search_inner(inner, station->distance);
+
+  void *child;
+  int key = insert_into(inner->children[i], level - 1, station, spares, &child);
+  *sibling = NULL;
+  if (child == NULL)
+    return 0;
+
+  // the key and the child to insert make room for themselves after the split child
+  if (inner->number_of_keys < inner_order - 1) {
+    memmove(&inner->keys[i + 1], &inner->keys[i], sizeof(int) * (inner->number_of_keys - i));
+    memmove(&inner->children[i + 2], &inner->children[i + 1], sizeof(void *) * (inner->number_of_keys - i));
+    inner->keys[i] = key;
+    inner->children[i + 1] = child;
+    inner->number_of_keys++;
+    return 0;
+  }
+
+  // the node is full: merges the new key and child with the existing ones, then splits them in half
+  int keys[inner_order];
+  void *children[inner_order + 1];
+  memcpy(keys, inner->keys, sizeof(int) * i);
+  memcpy(children, inner->children, sizeof(void *) * (i + 1));
+  keys[i] = key;
+  children[i + 1] = child;
+  memcpy(&keys[i + 1], &inner->keys[i], sizeof(int) * (inner_order - 1 - i));
+  memcpy(&children[i + 2], &inner->children[i + 1], sizeof(void *) * (inner_order - 1 - i));
+
+  // the middle key moves up to the parent
+  int half = inner_order / 2;
+  inner_node_t *right = (inner_node_t *) spares[level];
+  inner->number_of_keys = half - 1;
+  memcpy(inner->keys, keys, sizeof(int) * inner->number_of_keys);
+  memcpy(inner->children, children, sizeof(void *) * half);
+  right->number_of_keys = inner_order - half;
+  memcpy(right->keys, &keys[half], sizeof(int) * right->number_of_keys);
+  memcpy(right->children, &children[half], sizeof(void *) * (right->number_of_keys + 1));
+
+  *sibling = right;
+  return keys[half - 1];
+}
+
+/**
+ * @brief adds the station at the given distance in the given route.
+ *
+ * @param distance the distance to add the station.
+ * @return station_t* the added station, or NULL if already present.
+ */
+station_t *add_station(int distance) {
+  // the station already exists
+  if (get_from_table(distance) != null_station)
+    return NULL;
+
+  station_t *station = init_station(distance);
+  if (station == NULL)
+    return null_station;
+
+  if (root == NULL) {
+    root = calloc(1, sizeof(leaf_t));
+    if (root == NULL) {
+      free_station(station);
+      return null_station;
+    }
+    tree_height = 0;
+  }
+
+  // the nodes of the splits are reserved first, so that the insertion cannot fail halfway
+  void *spares[max_tree_height + 2];
+  if (!reserve_splits(distance, spares)) {
+    free_station(station);
+    return null_station;
+  }
+
+  // the tree grows from the root, when the root itself is split
+  void *sibling;
+  int key = insert_into(root, tree_height, station, spares, &sibling);
+  if (sibling != NULL) {
+    inner_node_t *new_root = (inner_node_t *) spares[tree_height + 1];
+    new_root->number_of_keys = 1;
+    new_root->keys[0] = key;
+    new_root->children[0] = root;
+    new_root->children[1] = sibling;
+    root = new_root;
+    tree_height++;
+  }
+
+  add_to_table(station);
+  number_of_stations++;
+  return station;
+}
+
+/**
+ * @brief removes the child following the given key of an inner node, along with the key.
+ *
+ * @param node the inner node.
+ * @param i the index of the key.
+ */
+void remove_child(inner_node_t *node, int i) {
+  memmove(&node->keys[i], &node->keys[i + 1], sizeof(int) * (node->number_of_keys - i - 1));
+  memmove(&node->children[i + 1], &node->children[i + 2], sizeof(void *) * (node->number_of_keys - i - 1));
+  node->number_of_keys--;
+}
+
+/**
+ * @brief fixes two sibling leaves, one of which has too few stations, by merging them
+ * or by moving a station from the other one.
+ *
+ * @param parent the parent of the leaves.
+ * @param i the index of the key separating the leaves.
+ */
+void rebalance_leaves(inner_node_t *parent, int i) {
+  leaf_t *left = (leaf_t *) parent->children[i],
+      *right = (leaf_t *) parent->children[i + 1];
+
+  if (left->number_of_stations + right->number_of_stations <= leaf_order) {
+    // moves all the stations to the left leaf, and unlinks the right one
+    memcpy(&left->distances[left->number_of_stations], right->distances, sizeof(int) * right->number_of_stations);
+    memcpy(&left->max_ranges[left->number_of_stations], right->max_ranges, sizeof(int) * right->number_of_stations);
+    memcpy(&left->stations[left->number_of_stations], right->stations, sizeof(station_t *) * right->number_of_stations);
+    for (int j = 0; j < right->number_of_stations; j++)
+      right->stations[j]->leaf = left;
+    left->number_of_stations += right->number_of_stations;
+
+    left->next = right->next;
+    if (right->next != NULL)
+      right->next->previous = left;
+
+    free(right);
+    remove_child(parent, i);
+    return;
+  }
+
+  if (left->number_of_stations > right->number_of_stations) {
+    // moves the last station of the left leaf to the right one
+    int last = --left->number_of_stations;
+    station_t *station = left->stations[last];
+    place_station(right, 0, station);
+  } else {
+    // moves the first station of the right leaf to the left one
+    station_t *station = right->stations[0];
+    int following = --right->number_of_stations;
+    memmove(right->distances, &right->distances[1], sizeof(int) * following);
+    memmove(right->max_ranges, &right->max_ranges[1], sizeof(int) * following);
+    memmove(right->stations, &right->stations[1], sizeof(station_t *) * following);
+    place_station(left, left->number_of_stations, station);
+  }
+
+  parent->keys[i] = right->distances[0];
+}
+
+/**
+ * @brief fixes two sibling inner nodes, one of which has too few children, by merging them
+ * or by moving a child from the other one.
+ *
+ * @param parent the parent of the inner nodes.
+ * @param i the index of the key separating the inner nodes.
+ */
+void rebalance_inner_nodes(inner_node_t *parent, int i) {
+  inner_node_t *left = (inner_node_t *) parent->children[i],
+      *right = (inner_node_t *) parent->children[i + 1];
+
+  if (left->number_of_keys + right->number_of_keys + 2 <= inner_order) {
+    // the separating key moves down, between the keys of the two nodes
+    left->keys[left->number_of_keys] = parent->keys[i];
+    memcpy(&left->keys[left->number_of_keys + 1], right->keys, sizeof(int) * right->number_of_keys);
+    memcpy(&left->children[left->number_of_keys + 1], right->children, sizeof(void *) * (right->number_of_keys + 1));
+    left->number_of_keys += right->number_of_keys + 1;
+
+    free(right);
+    remove_child(parent, i);
+    return;
+  }
+
+  if (left->number_of_keys > right->number_of_keys) {
+    // rotates the last child of the left node to the right one
+    memmove(&right->keys[1], right->keys, sizeof(int) * right->number_of_keys);
+    memmove(&right->children[1], right->children, sizeof(void *) * (right->number_of_keys + 1));
+    right->keys[0] = parent->keys[i];
+    right->children[0] = left->children[left->number_of_keys];
+    right->number_of_keys++;
+
+    parent->keys[i] = left->keys[--left->number_of_keys];
+  } else {
+    // rotates the first child of the right node to the left one
+    left->keys[left->number_of_keys] = parent->keys[i];
+    left->children[left->number_of_keys + 1] = right->children[0];
+    left->number_of_keys++;
+
+    parent->keys[i] = right->keys[0];
+    right->number_of_keys--;
+    memmove(right->keys, &right->keys[1], sizeof(int) * right->number_of_keys);
+    memmove(right->children, &right->children[1], sizeof(void *) * (right->number_of_keys + 1));
+  }
+}
+
+/**
+ * @brief removes the station at the given distance from the sub tree with the given root,
+ * fixing the nodes left with too few stations or children.
+ *
+ * @param node the root of the sub tree.
+ * @param level the height of the sub tree.
+ * @param distance the distance to remove the station at.
+ * @return true if the station has been removed successfully.
+ * @return false otherwise.
+ */
+boolean remove_from(void *node, int level, int distance) {
+  if (level == 0) {
+    leaf_t *leaf = (leaf_t *) node;
+    int i = search_leaf(leaf, distance);
+    if (i == leaf->number_of_stations || leaf->distances[i] != distance)
+      return false;
+
+    station_t *station = leaf->stations[i];
+    int following = --leaf->number_of_stations - i;
+    memmove(&leaf->distances[i], &leaf->distances[i + 1], sizeof(int) * following);
+    memmove(&leaf->max_ranges[i], &leaf->max_ranges[i + 1], sizeof(int) * following);
+    memmove(&leaf->stations[i], &leaf->stations[i + 1], sizeof(station_t *) * following);
+
+    free_station(station);
+    return true;
+  }
+
+  inner_node_t *inner = (inner_node_t *) node;
+  int i = search_inner(inner, distance);
+  if (!remove_from(inner->children[i], level - 1, distance))
+    return false;
+
+  // the child is fixed together with its left sibling, or with its right one if it is the first child
+  int separator = i > 0 ? i - 1 : 0;
+  if (level == 1) {
+    if (((leaf_t *) inner->children[i])->number_of_stations < leaf_order / 2)
+      rebalance_leaves(inner, separator);
+  } else if (((inner_node_t *) inner->children[i])->number_of_keys + 1 < inner_order / 2)
+    rebalance_inner_nodes(inner, separator);
+
+  return true;
+}
+
+/**
+ * @brief removes the station at the given distance in the given route.
+ *
+ * @param distance the distance to remove the station at.
+ * @return true if the station has been removed successfully.
+ * @return false otherwise.
+ */
+boolean remove_station(int distance) {
+  if (root == NULL || !remove_from(root, tree_height, distance))
+    return false;
+
+  // the tree shrinks from the root, when the root is left with a single child or no stations
+  if (tree_height > 0 && ((inner_node_t *) root)->number_of_keys == 0) {
+    void *old_root = root;
+    root = ((inner_node_t *) root)->children[0];
+    tree_height--;
+    free(old_root);
+  } else if (tree_height == 0 && ((leaf_t *) root)->number_of_stations == 0) {
+    free(root);
+    root = NULL;
+  }
+
+  remove_from_table(distance);
+  number_of_stations--;
+  return true;
+}
+
+/**
+ * @brief copies the distances and the maximum ranges of the stations between the given distances in the window.
+ * the stations are read leaf by leaf, from the leaf of the first one.
+ *
+ * @param from the distance of the first station, which must be in the route.
+ * @param to the maximum distance of the stations to copy.
+ * @return int the number of stations copied.
+ */
+int collect_stations(int from, int to) {
+  ensure_window();
+
+  leaf_t *leaf = get_from_table(from)->leaf;
+  int first = search_leaf(leaf, from);
+  int length = 0;
+
+  while (leaf != NULL) {
+    // the stations of the leaf that are in the window
+    int last = leaf->number_of_stations;
+    while (last > first && leaf->distances[last - 1] > to)
+      last--;
+
+    memcpy(&window_distances[length], &leaf->distances[first], sizeof(int) * (last - first));
+    memcpy(&window_ranges[length], &leaf->max_ranges[first], sizeof(int) * (last - first));
+    length += last - first;
+
+    if (last < leaf->number_of_stations)
+      break;
+
+    leaf = leaf->next;
+    first = 0;
+  }
+
+  return length;
+}
+
+/**
+ * @brief gets the minimum distance of the stations, the first of the first leaf. the route must not be empty.
+ *
+ * @return int the minimum distance.
+ */
+int minimum_distance() {
+  return find_leaf(INT_MIN)->distances[0];
+}
+
+/**
+ * @brief gets the maximum distance of the stations, the last of the last leaf. the route must not be empty.
+ *
+ * @return int the maximum distance.
+ */
+int maximum_distance() {
+  leaf_t *leaf = find_leaf(INT_MAX);
+  return leaf->distances[leaf->number_of_stations - 1];
+}
+#elif station_index == radix_bitmap_index
+/**
+ * @brief gets the station at the given distance.
+ * the radix bitmap only orders the distances, so the station is found through the hash table.
+ *
+ * @param distance the distance at where the station should be found.
+ * @return station_t* the found station, or the null station if none is found.
+ */
+station_t *get_at(int distance) {
+  return get_from_table(distance);
+}
+
+/**
+ * @brief finds the index, among the children of the given node, of the child at the given slot.
+ *
+ * @param node the node.
+ * @param slot the slot of the child.
+ * @return int the number of children before the slot.
+ */
+int radix_rank(const radix_node_t *node, int slot) {
+  return __builtin_popcountll(node->bits & ((1ULL << slot) - 1));
+}
+
+/**
+ * @brief adds the given key to the radix bitmap, creating the missing nodes on its path.
+ *
+ * @param key the key to add.
+ */
+void radix_insert(uint64_t key) {
+  radix_node_t *node = &radix_root;
+  for (int level = radix_height; level > 0; level--) {
+    int slot = radix_slot(key, level);
+    int rank = radix_rank(node, slot);
+
+    if (!(node->bits >> slot & 1)) {
+      // makes room for the new child, keeping the children in order
+      int count = __builtin_popcountll(node->bits);
+      node->children = (radix_node_t *) realloc(node->children, sizeof(radix_node_t) * (count + 1));
+      memmove(&node->children[rank + 1], &node->children[rank], sizeof(radix_node_t) * (count - rank));
+      node->children[rank].bits = 0;
+      node->children[rank].children = NULL;
+      node->bits |= 1ULL << slot;
+    }
+
+    node = &node->children[rank];
+  }
+
+  node->bits |= 1ULL << radix_slot(key, 0);
+}
+
+/**
+ * @brief removes the given key from the sub tree with the given root, freeing the nodes left empty.
+ *
+ * @param node the root of the sub tree, which must contain the key.
+ * @param level the level of the root.
+ * @param key the key to remove.
+ * @return true if the root has been left empty.
+ * @return false otherwise.
+ */
+boolean radix_remove(radix_node_t *node, int level, uint64_t key) {
+  int slot = radix_slot(key, level);
+
+  if (level > 0) {
+    int rank = radix_rank(node, slot);
+    if (!radix_remove(&node->children[rank], level - 1, key))
+      return false;
+
+    // the child has been left empty, so it is removed
+    int count = __builtin_popcountll(node->bits) - 1;
+    if (count == 0) {
+      free(node->children);
+      node->children = NULL;
+    } else
+      memmove(&node->children[rank], &node->children[rank + 1], sizeof(radix_node_t) * (count - rank));
+  }
+
+  node->bits &= ~(1ULL << slot);
+  return node->bits == 0;
+}
+
+/**
+ * @brief adds the station at the given distance in the given route.
+ *
+ * @param distance the distance to add the station.
+ * @return station_t* the added station, or NULL if already present.
+ */
+station_t *add_station(int distance) {
+  // the station already exists
+  if (get_from_table(distance) != null_station)
+    return NULL;
+
+  station_t *station = init_station(distance);
+  if (station == NULL)
+    return null_station;
+
+  radix_insert(radix_key(distance));
+  add_to_table(station);
+  number_of_stations++;
+  return station;
+}
+
+/**
+ * @brief removes the station at the given distance in the given route.
+ *
+ * @param distance the distance to remove the station at.
+ * @return true if the station has been removed successfully.
+ * @return false otherwise.
+ */
+boolean remove_station(int distance) {
+  station_t *station = get_from_table(distance);
+  if (station == null_station)
+    return false;
+
+  radix_remove(&radix_root, radix_height, radix_key(distance));
+  free_station(station);
+  remove_from_table(distance);
+  number_of_stations--;
+  return true;
+}
+
+/**
+ * @brief copies in the window the stations of the sub tree with the given root whose keys are between the given ones.
+ *
+ * @param node the root of the sub tree.
+ * @param level the level of the root.
+ * @param prefix the bits of the keys of the sub tree above its level.
+ * @param from the smallest key to copy.
+ * @param to the greatest key to copy.
+ * @param length the number of stations already in the window.
+ * @return int the number of stations in the window.
+ */
+int radix_collect(const radix_node_t *node, int level, uint64_t prefix, uint64_t from, uint64_t to, int length) {
+  int shift = radix_bits * level;
+  uint64_t bits = node->bits;
+
+  // skips the children whose keys are all smaller than the first one
+  if ((from >> shift >> radix_bits) == (prefix >> shift >> radix_bits))
+    bits &= ~0ULL << radix_slot(from, level);
+
+  for (; bits != 0; bits &= bits - 1) {
+    int slot = __builtin_ctzll(bits);
+    uint64_t key = prefix | (uint64_t) slot << shift;
+    if (key > to)
+      break;
+
+    if (level > 0)
+      length = radix_collect(&node->children[radix_rank(node, slot)], level - 1, key, from, to, length);
+    else {
+      window_distances[length] = radix_distance(key);
+      window_ranges[length++] = get_from_table(radix_distance(key))->max_range;
+    }
+  }
+
+  return length;
+}
+
+/**
+ * @brief copies the distances and the maximum ranges of the stations between the given distances in the window.
+ * the distances are visited in order in the radix bitmap, and the stations are found through the hash table.
+ *
+ * @param from the distance of the first station, which must be in the route.
+ * @param to the maximum distance of the stations to copy.
+ * @return int the number of stations copied.
+ */
+int collect_stations(int from, int to) {
+  ensure_window();
+  return radix_collect(&radix_root, radix_height, 0, radix_key(from), radix_key(to), 0);
+}
+
+/**
+ * @brief gets the minimum distance of the stations, following the first child down the radix bitmap. the route must not be empty.
+ *
+ * @return int the minimum distance.
+ */
+int minimum_distance() {
+  const radix_node_t *node = &radix_root;
+  uint64_t key = 0;
+  for (int level = radix_height; level > 0; level--) {
+    key |= (uint64_t) __builtin_ctzll(node->bits) << (radix_bits * level);
+    node = &node->children[0];
+  }
+
+  return radix_distance(key | (uint64_t) __builtin_ctzll(node->bits));
+}
+
+/**
+ * @brief gets the maximum distance of the stations, following the last child down the radix bitmap. the route must not be empty.
+ *
+ * @return int the maximum distance.
+ */
+int maximum_distance() {
+  const radix_node_t *node = &radix_root;
+  uint64_t key = 0;
+  for (int level = radix_height; level > 0; level--) {
+    key |= (uint64_t) (63 - __builtin_clzll(node->bits)) << (radix_bits * level);
+    node = &node->children[__builtin_popcountll(node->bits) - 1];
+  }
+
+  return radix_distance(key | (uint64_t) (63 - __builtin_clzll(node->bits)));
+}
+#elif station_index == sorted_arrays_index
+/**
+ * @brief gets the station at the given distance.
+ *
+ * @param distance the distance at where the station should be found.
+ * @return station_t* the found station, or the null station if none is found.
+ */
+station_t *get_at(int distance) {
+  return get_from_table(distance);
+}
+
+/**
+ * @brief searches the position of the given distance in the sorted arrays.
+ *
+ * @param distance the distance to search.
+ * @return int the index of the first station at a distance not smaller than the given one.
+ */
+int search_hot(int distance) {
+  int low = 0,
+      high = number_of_stations;
+
+  while (low < high) {
+    int middle = (low + high) / 2;
+    if (hot_distances[middle] < distance)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  return low;
+}
+
+/**
+ * @brief adds the station at the given distance in the given route.
+ *
+ * @param distance the distance to add the station.
+ * @return station_t* the added station, or NULL if already present.
+ */
+station_t *add_station(int distance) {
+  // the station already exists
+  if (get_from_table(distance) != null_station)
+    return NULL;
+
+  // the arrays grow before anything changes, so that a failure leaves them as they were
+  if (number_of_stations == hot_capacity) {
+    int capacity = hot_capacity == 0 ? initial_table_capacity : hot_capacity * 2;
+    int *distances = (int *) realloc(hot_distances, sizeof(int) * capacity);
+    if (distances == NULL)
+      return null_station;
+    hot_distances = distances;
+
+    int *ranges = (int *) realloc(hot_ranges, sizeof(int) * capacity);
+    if (ranges == NULL)
+      return null_station;
+    hot_ranges = ranges;
+    hot_capacity = capacity;
+  }
+
+  station_t *station = init_station(distance);
+  if (station == NULL)
+    return null_station;
+
+  // shifts the following stations to make room for the new one
+  int i = search_hot(distance);
+  memmove(&hot_distances[i + 1], &hot_distances[i], sizeof(int) * (number_of_stations - i));
+  memmove(&hot_ranges[i + 1], &hot_ranges[i], sizeof(int) * (number_of_stations - i));
+  hot_distances[i] = distance;
+  hot_ranges[i] = 0;
+
+  add_to_table(station);
+  number_of_stations++;
+  return station;
+}
+
+/**
+ * @brief removes the station at the given distance in the given route.
+ *
+ * @param distance the distance to remove the station at.
+ * @return true if the station has been removed successfully.
+ * @return false otherwise.
+ */
+boolean remove_station(int distance) {
+  station_t *station = get_from_table(distance);
+  if (station == null_station)
+    return false;
+
+  int i = search_hot(distance);
+  memmove(&hot_distances[i], &hot_distances[i + 1], sizeof(int) * (number_of_stations - i - 1));
+  memmove(&hot_ranges[i], &hot_ranges[i + 1], sizeof(int) * (number_of_stations - i - 1));
+
+  free_station(station);
+  remove_from_table(distance);
+  number_of_stations--;
+  return true;
+}
+
+/**
+ * @brief points the window to the stations between the given distances in the sorted arrays.
+ * nothing is copied: the planner reads the distances and the maximum ranges in place.
+ *
+ * @param from the distance of the first station, which must be in the route.
+ * @param to the distance of the last station, which must be in the route.
+ * @return int the number of stations in the window.
+ */
+int collect_stations(int from, int to) {
+  int first = search_hot(from);
+  window_distances = &hot_distances[first];
+  window_ranges = &hot_ranges[first];
+
+  return search_hot(to) + 1 - first;
+}
+
+/**
+ * @brief gets the minimum distance of the stations, the first of the sorted arrays. the route must not be empty.
+ *
+ * @return int the minimum distance.
+ */
+int minimum_distance() {
+  return hot_distances[0];
+}
+
+/**
+ * @brief gets the maximum distance of the stations, the last of the sorted arrays. the route must not be empty.
+ *
+ * @return int the maximum distance.
+ */
+int maximum_distance() {
+  return hot_distances[number_of_stations - 1];
+}
+#elif station_index == persistent_tree_index
+/**
+ * @brief gets the station at the given distance.
+ * the versions only order the distances, so the station is found through the hash table.
+ *
+ * @param distance the distance at where the station should be found.
+ * @return station_t* the found station, or the null station if none is found.
+ */
+station_t *get_at(int distance) {
+  return get_from_table(distance);
+}
+
+/**
+ * @brief allocates a node of the persistent tree.
+ *
+ * @param distance the distance of the node.
+ * @param max_range the maximum range of the station at the distance.
+ * @param left the left child, whose reference passes to the node.
+ * @param right the right child, whose reference passes to the node.
+ * @return version_node_t* the node, referenced once.
+ */
+version_node_t *new_node(int distance, int max_range, version_node_t *left, version_node_t *right) {
+  version_node_t *node = (version_node_t *) pool_alloc(&version_pool);
+  node->distance = distance;
+  node->max_range = max_range;
+  node->priority = version_priority(distance);
+  atomic_init(&node->references, 1);
+  node->left = left;
+  node->right = right;
+
+  return node;
+}
+
+/**
+ * @brief adds a reference to the given node.
+ *
+ * @param node the node, or NULL.
+ * @return version_node_t* the node.
+ */
+version_node_t *retain(version_node_t *node) {
+  if (node != NULL)
+    atomic_fetch_add_explicit(&node->references, 1, memory_order_relaxed);
+
+  return node;
+}
+
+/**
+ * @brief drops a reference to the given node, freeing it and releasing its children if it was the last one.
+ *
+ * @param node the node, or NULL.
+ */
+void release(version_node_t *node) {
+  while (node != NULL && atomic_fetch_sub_explicit(&node->references, 1, memory_order_acq_rel) == 1) {
+    version_node_t *right = node->right;
+    release(node->left);
+    pool_free(&version_pool, node);
+    node = right;
+  }
+}
+
+/**
+ * @brief pins the latest version of the tree, which stays valid whatever changes follow until it is unpinned.
+ * only the thread that changes the tree can pin a version, but any thread can then read it and unpin it.
+ *
+ * @return version_node_t* the root of the version, or NULL if the route is empty.
+ */
+version_node_t *pin_version() {
+  return retain(current_version);
+}
+
+/**
+ * @brief unpins a version of the tree. if it was the last reference to its root, the version is left to the
+ * thread that changes the tree, which frees the nodes that no other version shares on its next change.
+ *
+ * @param version the root of the version, or NULL.
+ */
+void unpin_version(version_node_t *version) {
+  if (version == NULL || atomic_fetch_sub_explicit(&version->references, 1, memory_order_acq_rel) != 1)
+    return;
+
+  retired_version_t *retired = (retired_version_t *) malloc(sizeof(retired_version_t));
+  retired->root = version;
+  retired->next = atomic_load_explicit(&retired_versions, memory_order_relaxed);
+  while (!atomic_compare_exchange_weak_explicit(&retired_versions, &retired->next, retired,
+                                                memory_order_release, memory_order_relaxed));
+}
+
+/**
+ * @brief frees the versions unpinned for the last time by the threads that read them.
+ * only the thread that changes the tree can call it.
+ */
+void free_retired_versions() {
+  retired_version_t *retired = atomic_exchange_explicit(&retired_versions, NULL, memory_order_acquire);
+  while (retired != NULL) {
+    retired_version_t *next = retired->next;
+    // the root has no references left, so only its children are released
+    release(retired->root->left);
+    release(retired->root->right);
+    pool_free(&version_pool, retired->root);
+    free(retired);
+    retired = next;
+  }
+}
+
+/**
+ * @brief makes the given version the latest one, releasing the previous one
+ * and freeing the versions unpinned by other threads in the meantime.
+ *
+ * @param version the root of the version, whose reference passes to the tree.
+ */
+void publish_version(version_node_t *version) {
+  release(current_version);
+  current_version = version;
+
+  if (atomic_load_explicit(&retired_versions, memory_order_relaxed) != NULL)
+    free_retired_versions();
+}
+
+/**
+ * @brief splits the given sub tree in the nodes before and after the given distance, copying the nodes on the way.
+ *
+ * @param node the root of the sub tree, which does not contain the distance.
+ * @param distance the distance where to split.
+ * @param less where to store the sub tree of the smaller distances.
+ * @param greater where to store the sub tree of the greater distances.
+ */
+void split_version(const version_node_t *node, int distance, version_node_t **less, version_node_t **greater) {
+  if (node == NULL) {
+    *less = NULL;
+    *greater = NULL;
+  } else if (node->distance < distance) {
+    version_node_t *right_less;
+    split_version(node->right, distance, &right_less, greater);
+    *less = new_node(node->distance, node->max_range, retain(node->left), right_less);
+  } else {
+    version_node_t *left_greater;
+    split_version(node->left, distance, less, &left_greater);
+    *greater = new_node(node->distance, node->max_range, left_greater, retain(node->right));
+  }
+}
+
+/**
+ * @brief merges the given sub trees, copying the nodes on the way.
+ *
+ * @param less the sub tree of the smaller distances.
+ * @param greater the sub tree of the greater distances.
+ * @return version_node_t* the merged sub tree.
+ */
+version_node_t *merge_versions(const version_node_t *less, const version_node_t *greater) {
+  if (less == NULL)
+    return retain((version_node_t *) greater);
+  if (greater == NULL)
+    return retain((version_node_t *) less);
+
+  if (less->priority > greater->priority)
+    return new_node(less->distance, less->max_range, retain(less->left), merge_versions(less->right, greater));
+
+  return new_node(greater->distance, greater->max_range, merge_versions(less, greater->left), retain(greater->right));
+}
+
+/**
+ * @brief inserts a node at the given distance in the given sub tree, copying the path to it.
+ *
+ * @param node the root of the sub tree, which does not contain the distance.
+ * @param distance the distance of the new node.
+ * @param priority the priority of the new node.
+ * @return version_node_t* the new sub tree.
+ */
+version_node_t *insert_into_version(const version_node_t *node, int distance, unsigned priority) {
+  // the new node goes above the ones with a smaller priority
+  if (node == NULL || priority > node->priority) {
+    version_node_t *less, *greater;
+    split_version(node, distance, &less, &greater);
+    return new_node(distance, 0, less, greater);
+  }
+
+  if (distance < node->distance)
+    return new_node(node->distance, node->max_range, insert_into_version(node->left, distance, priority),
+                    retain(node->right));
+
+  return new_node(node->distance, node->max_range, retain(node->left),
+                  insert_into_version(node->right, distance, priority));
+}
+
+/**
+ * @brief removes the node at the given distance from the given sub tree, copying the path to it.
+ *
+ * @param node the root of the sub tree, which contains the distance.
+ * @param distance the distance of the node to remove.
+ * @return version_node_t* the new sub tree.
+ */
+version_node_t *remove_from_version(const version_node_t *node, int distance) {
+  if (node->distance == distance)
+    return merge_versions(node->left, node->right);
+
+  if (distance < node->distance)
+    return new_node(node->distance, node->max_range, remove_from_version(node->left, distance), retain(node->right));
+
+  return new_node(node->distance, node->max_range, retain(node->left), remove_from_version(node->right, distance));
+}
+
+/**
+ * @brief changes the maximum range of the node at the given distance in the given sub tree, copying the path to it.
+ *
+ * @param node the root of the sub tree, which contains the distance.
+ * @param distance the distance of the node.
+ * @param max_range the new maximum range.
+ * @return version_node_t* the new sub tree.
+ */
+version_node_t *update_version(const version_node_t *node, int distance, int max_range) {
+  if (node->distance == distance)
+    return new_node(distance, max_range, retain(node->left), retain(node->right));
+
+  if (distance < node->distance)
+    return new_node(node->distance, node->max_range, update_version(node->left, distance, max_range),
+                    retain(node->right));
+
+  return new_node(node->distance, node->max_range, retain(node->left),
+                  update_version(node->right, distance, max_range));
+}
+
+/**
+ * @brief adds the station at the given distance in the given route.
+ *
+ * @param distance the distance to add the station.
+ * @return station_t* the added station, or NULL if already present.
+ */
+station_t *add_station(int distance) {
+  // the station already exists
+  if (get_from_table(distance) != null_station)
+    return NULL;
+
+  station_t *station = init_station(distance);
+  if (station == NULL)
+    return null_station;
+
+  publish_version(insert_into_version(current_version, distance, version_priority(distance)));
+  add_to_table(station);
+  number_of_stations++;
+  return station;
+}
+
+/**
+ * @brief removes the station at the given distance in the given route.
+ *
+ * @param distance the distance to remove the station at.
+ * @return true if the station has been removed successfully.
+ * @return false otherwise.
+ */
+boolean remove_station(int distance) {
+  station_t *station = get_from_table(distance);
+  if (station == null_station)
+    return false;
+
+  publish_version(remove_from_version(current_version, distance));
+  free_station(station);
+  remove_from_table(distance);
+  number_of_stations--;
+  return true;
+}
+
+/**
+ * @brief counts the nodes of the given sub tree between the given distances.
+ *
+ * @param node the root of the sub tree.
+ * @param from the minimum distance of the nodes to count.
+ * @param to the maximum distance of the nodes to count.
+ * @return int the number of nodes.
+ */
+int count_version(const version_node_t *node, int from, int to) {
+  int count = 0;
+  while (node != NULL) {
+    if (node->distance < from)
+      node = node->right;
+    else if (node->distance > to)
+      node = node->left;
+    else {
+      count += count_version(node->left, from, to) + 1;
+      node = node->right;
+    }
+  }
+
+  return count;
+}
+
+/**
+ * @brief copies in the given arrays the nodes of the given sub tree between the given distances, in order.
+ *
+ * @param node the root of the sub tree.
+ * @param from the minimum distance of the nodes to copy.
+ * @param to the maximum distance of the nodes to copy.
+ * @param distances where to copy the distances of the nodes.
+ * @param ranges where to copy the maximum ranges of the nodes.
+ * @param length the number of stations already in the arrays.
+ * @return int the number of stations in the arrays.
+ */
+int collect_version(const version_node_t *node, int from, int to, int *distances, int *ranges, int length) {
+  while (node != NULL) {
+    if (node->distance < from)
+      node = node->right;
+    else if (node->distance > to)
+      node = node->left;
+    else {
+      length = collect_version(node->left, from, to, distances, ranges, length);
+      distances[length] = node->distance;
+      ranges[length++] = node->max_range;
+      node = node->right;
+    }
+  }
+
+  return length;
+}
+
+/**
+ * @brief checks whether the given version has a station at the given distance.
+ *
+ * @param node the root of the version.
+ * @param distance the distance of the station.
+ * @return true if the station is in the version.
+ * @return false otherwise.
+ */
+boolean version_contains(const version_node_t *node, int distance) {
+  while (node != NULL && node->distance != distance)
+    node = distance < node->distance ? node->left : node->right;
+
+  return node != NULL;
+}
+
+/**
+ * @brief plans the route between the given distances on the given pinned version, from any thread:
+ * the version never changes, and the window of its stations is allocated for the plan alone.
+ *
+ * @param version the root of the pinned version.
+ * @param distance1 the distance from which to plan the route.
+ * @param distance2 the distance of the station to be reached.
+ * @return int* an array of distances indicating the stations where to stop and change car, or NULL if none.
+ */
+int *plan_version(const version_node_t *version, int distance1, int distance2) {
+  if (!version_contains(version, distance1) || !version_contains(version, distance2))
+    return NULL;
+
+  if (distance1 == distance2) {
+    int *output = (int *) malloc(sizeof(int) * 2);
+    output[0] = distance1;
+    output[1] = -1;
+
+    return output;
+  }
+
+  int from = distance1 < distance2 ? distance1 : distance2,
+      to = distance1 < distance2 ? distance2 : distance1;
+  int length = count_version(version, from, to);
+  int *distances = (int *) malloc(sizeof(int) * length);
+  int *ranges = (int *) malloc(sizeof(int) * length);
+  collect_version(version, from, to, distances, ranges, 0);
+
+  int *output = distance1 < distance2 ? explore_forward(distances, ranges, length)
+                                      : explore_backward(distances, ranges, length);
+
+  free(distances);
+  free(ranges);
+  return output;
+}
+
+/**
+ * @brief copies the distances and the maximum ranges of the stations between the given distances in the window,
+ * reading them from the latest version of the tree.
+ *
+ * @param from the distance of the first station, which must be in the route.
+ * @param to the maximum distance of the stations to copy.
+ * @return int the number of stations copied.
+ */
+int collect_stations(int from, int to) {
+  ensure_window();
+
+  return collect_version(current_version, from, to, window_distances, window_ranges, 0);
+}
+
+/**
+ * @brief gets the minimum distance of the stations in the latest version. the route must not be empty.
+ *
+ * @return int the minimum distance.
+ */
+int minimum_distance() {
+  const version_node_t *node = current_version;
+  while (node->left != NULL)
+    node = node->left;
+
+  return node->distance;
+}
+
+/**
+ * @brief gets the maximum distance of the stations in the latest version. the route must not be empty.
+ *
+ * @return int the maximum distance.
+ */
+int maximum_distance() {
+  const version_node_t *node = current_version;
+  while (node->right != NULL)
+    node = node->right;
+
+  return node->distance;
+}
+#endif
+
+/**
+ * @brief adds the car in the given station with the given range.
+ *
+ * @param station the station where to add the car.
+ * @param range the range of the car to be added.
+ * @return true if the car has been added successfully.
+ * @return false otherwise.
+ */
+boolean add_car(station_t *station, int range) {
+  if (station == NULL || station == null_station || station->number_of_cars == max_cars)
+    return false;
+
+  // grows the array if it is full
+  if (station->number_of_cars == station->car_capacity && !grow_cars(station))
+    return false;
+
+  // checks if the given range is grater than the maximum one in the given station
+  if (range > station->max_range)
+    set_max_range(station, range);
+
+  // adds the car in last available position, then restores the heap
+  station->cars[station->number_of_cars] = range;
+  sift_up(station->cars, station->number_of_cars++);
+
+  return true;
+}
+
+/**
+ * @brief adds the cars with the given ranges in the given station, up to the maximum number of cars.
+ * the cars are appended and the heap is built once, in linear time, instead of inserting them one at a time.
+ *
+ * @param station the station where to add the cars.
+ * @param ranges the ranges of the cars to be added.
+ * @param count the number of cars to be added.
+ */
+void add_cars(station_t *station, const int *ranges, int count) {
+  if (count > max_cars - station->number_of_cars)
+    count = max_cars - station->number_of_cars;
+  if (count <= 0)
+    return;
+
+  // without memory to grow the array, only the cars that fit are added
+  while (station->number_of_cars + count > station->car_capacity)
+    if (!grow_cars(station)) {
+      count = station->car_capacity - station->number_of_cars;
+      break;
+    }
+  if (count <= 0)
+    return;
+
+  memcpy(&station->cars[station->number_of_cars], ranges, sizeof(int) * count);
+  station->number_of_cars += count;
+  for (int i = station->number_of_cars / 2 - 1; i >= 0; i--)
+    sift_down(station->cars, station->number_of_cars, i);
+
+  // checks if the greatest range is grater than the maximum one in the given station
+  if (station->cars[0] > station->max_range)
+    set_max_range(station, station->cars[0]);
+}
+
+/**
+ * @brief removes the car with the given range from the given station.
+ *
+ * @param station the station from which to remove the car.
+ * @param range the range of the car to be removed.
+ * @return true if the car has been removed successfully.
+ * @return false otherwise.
+ */
+boolean remove_car(station_t *station, int range) {
+  if (station == NULL || station == null_station || station->number_of_cars == 0)
+    return false;
+
+  // checks if the car exists in the array of cars and retrieves its index.
+  int i = contains_car(station, range);
+  if (i != -1) {
+    // replaces the car with the last one, which moves up or down to restore the heap
+    int *cars = station->cars;
+    int length = --station->number_of_cars;
+    if (i < length) {
+      cars[i] = cars[length];
+      if (i > 0 && cars[(i - 1) / 2] < cars[i])
+        sift_up(cars, i);
+      else
+        sift_down(cars, length, i);
+    }
+
+    // the maximum range available in the given station is the first car left, if any
+    if (i == 0)
+      set_max_range(station, length > 0 ? cars[0] : 0);
+
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * @brief fills the sub tree of the Eytzinger layout with the given root with the frozen stations, in order.
+ *
+ * @param i the index of the first frozen station to place.
+ * @param k the root of the sub tree: the children of node k are 2k and 2k + 1.
+ * @return int the index of the first frozen station not placed.
+ */
+int fill_eytzinger(int i, int k) {
+  if (k <= number_of_frozen) {
+    i = fill_eytzinger(i, 2 * k);
+    eytzinger_distances[k] = frozen_distances[i];
+    eytzinger_ranks[k] = i++;
+    i = fill_eytzinger(i, 2 * k + 1);
+  }
+
+  return i;
+}
+
+/**
+ * @brief freezes the stations: copies their distances and maximum ranges in ascending order,
+ * so that the next plans read them in place, and lays the distances out for the search.
+ */
+void freeze_stations() {
+  int length = collect_stations(minimum_distance(), maximum_distance());
+
+  if (length >= frozen_capacity) {
+    frozen_capacity = length * 2;
+    frozen_distances = (int *) realloc(frozen_distances, sizeof(int) * frozen_capacity);
+    frozen_ranges = (int *) realloc(frozen_ranges, sizeof(int) * frozen_capacity);
+    eytzinger_distances = (int *) realloc(eytzinger_distances, sizeof(int) * (frozen_capacity + 1));
+    eytzinger_ranks = (int *) realloc(eytzinger_ranks, sizeof(int) * (frozen_capacity + 1));
+  }
+
+  memcpy(frozen_distances, window_distances, sizeof(int) * length);
+  memcpy(frozen_ranges, window_ranges, sizeof(int) * length);
+  number_of_frozen = length;
+  fill_eytzinger(0, 1);
+
+  frozen = true;
+}
 
 /**
- * @brief fixes the tree properties after an insertion.
- * * DO NOT TOUCH! From Cormen book
+ * @brief drops the frozen stations, since they are going to change.
+ */
+void thaw_stations() {
+  frozen = false;
+  consecutive_plans = 0;
+  collected_in_a_row = 0;
+}
+
+/**
+ * @brief searches the given distance in the frozen stations, without branches:
+ * the descent always goes through the whole height of the Eytzinger layout.
  *
- * @param z the station that was inserted.
+ * @param distance the distance to search, which must be in the route.
+ * @return int the index of the station in ascending order.
  */
-void insert_fixup(station_t *z) {
-  station_t *y = NULL;
+int search_frozen(int distance) {
+  unsigned k = 1;
+  while (k <= (unsigned) number_of_frozen) {
+    // the nodes 4 levels below share a cache line, so they are requested while this level gets compared
+    __builtin_prefetch(&eytzinger_distances[k * 16]);
+    k = 2 * k + (eytzinger_distances[k] < distance);
+  }
 
-  while (z->parent->color == red) {
-    if (z->parent == z->parent->parent->left) {
-      y = z->parent->parent->right;
-      if (y->color == red) {
-        z->parent->color = black;
-        y->color = black;
-        z->parent->parent->color = red;
-        z = z->parent->parent;
-      } else {
-        if (z == z->parent->right) {
-          z = z->parent;
-          left_rotate(z);
-        }
-        z->parent->color = black;
-        z->parent->parent->color = red;
-        right_rotate(z->parent->parent);
-      }
+  // goes back up to the last node where the descent turned left, which is the first not smaller one
+  k >>= __builtin_ffs(~k);
+  return eytzinger_ranks[k];
+}
+
+/**
+ * @brief optimizes the given route to be minimal.
+ *
+ * @param distances the distances of the stations of the window, in ascending order.
+ * @param ranges the maximum ranges of the stations of the window.
+ * @param unoptimized an unoptimized minimum path, as indexes of the window, with room for the delimiter.
+ * @param length the length of the route
+ * @return int* the minimum optimized path
+ */
+int *optimize(const int *distances, const int *ranges, int *unoptimized, int length) {
+  int i = length - 1;
+  int current = unoptimized[i],
+      target = unoptimized[i];
+
+  while (true) {
+    current++;
+
+    // reached the end of the array
+    if (current == unoptimized[0])
+      break;
+
+    if (i >= 1 && current == unoptimized[i - 1]) {
+      target = current;
+      i--;
+      continue;
     } else {
-      y = z->parent->parent->left;
-      if (y->color == red) {
-        z->parent->color = black;
-        y->color = black;
-        z->parent->parent->color = red;
-        z = z->parent->parent;
-      } else {
-        if (z == z->parent->left) {
-          z = z->parent;
-          right_rotate(z);
-        }
-        z->parent->color = black;
-        z->parent->parent->color = red;
-        left_rotate(z->parent->parent);
-      }
+      // checks if the current station can reach the target one and
+      // if it can be reached from the next station in the array.
+      if (
+          i >= 2 && distances[current] - ranges[current] <= distances[target] &&
+          distances[unoptimized[i - 2]] - ranges[unoptimized[i - 2]] <= distances[current] &&
+          distances[current] < distances[unoptimized[i - 1]] //
+          ) {
+        // inserts the node in the output array, replacing the unoptimized one.
+        unoptimized[i - 1] = current;
+        target = current;
+        i--;
+
+      } else
+        continue;
     }
   }
 
-  root->color = black;
+  // replaces the indexes with the distances (including -1 as a delimiter)
+  for (int j = 0; j < length; j++)
+    unoptimized[j] = distances[unoptimized[j]];
+  unoptimized[length] = -1;
+
+  return unoptimized;
 }
 
 /**
- * @brief fixes the tree properties after a deletion.
- * * DO NOT TOUCH! From Cormen book
+ * @brief explores the minimum path from the first to the last station of the window.
+ * this is called when the distance of station1 is smaller than the station2 distance.
+ * it takes advantage of the fact that the chosen stations must have the smallest distance from the origin:
+ * going back from station2, every stop is the leftmost station that reaches the previous one.
+ * that is the first station where the farthest distance reached so far gets to the previous stop, and since
+ * the stops move left, so does it: the window is swept once forward and once backward.
  *
- * @param z the station that was deleted.
+ * @param distances the distances of the stations of the window, in ascending order.
+ * @param ranges the maximum ranges of the stations of the window.
+ * @param length the number of stations in the window.
+ * @return int* the minimum path from station1 to station2.
  */
-void delete_fixup(station_t *z) {
-  station_t *w = NULL;
+int *explore_forward(const int *distances, const int *ranges, int length) {
+  // the farthest distance reached by the stations up to every one
+  long *reach = (long *) malloc(sizeof(long) * length);
+  long farthest = LONG_MIN;
+  for (int i = 0; i < length; i++) {
+    if ((long) distances[i] + ranges[i] > farthest)
+      farthest = (long) distances[i] + ranges[i];
+    reach[i] = farthest;
+  }
 
-  if (z == NULL)
-    return;
+  int target = length - 1;
 
-  while (z != root && z->color == black) {
-    if (z == z->parent->left) {
-      w = z->parent->right;
+  // the route is found from station2 back to station1, and cannot have more stops than the window
+  int *output = (int *) malloc(sizeof(int) * (length + 1));
+  output[0] = distances[target];
+  int stops = 1;
 
-      if (w->color == red) {
-        w->color = black;
-        z->parent->color = red;
-        left_rotate(z->parent);
-        w = z->parent->right;
-      }
+  // finds the best node that can reach station2
+  int best = 0;
+  while (best < target && reach[best] < distances[target])
+    best++;
 
-      if (w->left->color == black && w->right->color == black) {
-        w->color = red;
-        z = z->parent;
-      } else {
-        if (w->right->color == black) {
-          w->left->color = black;
-          w->color = red;
-          right_rotate(w);
-          w = z->parent->right;
-        }
+  while (true) {
+    // if no node before the target can reach it, no path exists
+    if (best >= target) {
+      free(reach);
+      free(output);
+      return NULL;
+    }
 
-        w->color = z->parent->color;
-        z->parent->color = black;
-        w->right->color = black;
-        left_rotate(z->parent);
-        z = root;
-      }
-    } else {
-      w = z->parent->left;
+    // otherwise insert the best station in the output array
+    output[stops++] = distances[best];
+
+    // if the best node is the arrival station, it found the best path
+    if (best == 0) {
+      // reverses the stops in ascending order
+      for (int i = 0, j = stops - 1; i < j; i++, j--)
+        swap(output, i, j);
+      // inserts in the output array -1 as a delimiter
+      output[stops] = -1;
+
+      free(reach);
+      return output;
+    }
+
+    // the best node that can reach the new target is the same one or further left
+    target = best;
+    while (best > 0 && reach[best - 1] >= distances[target])
+      best--;
+  }
+}
+
+/**
+ * @brief explores the minimum path from the last to the first station of the window.
+ * this is called when the distance of station1 is grater than the distance of station2.
+ *
+ * @param distances the distances of the stations of the window, in ascending order.
+ * @param ranges the maximum ranges of the stations of the window.
+ * @param length the number of stations in the window.
+ * @return int* the minimum path from station1 to station2.
+ */
+int *explore_backward(const int *distances, const int *ranges, int length) {
+  int current = length - 1,
+      target = length - 1,
+      best = length - 1;
+
+  // the indexes of the stops: station2 may be inserted twice, plus the delimiter
+  int *unoptimized = (int *) malloc(sizeof(int) * (length + 2));
+  unoptimized[0] = current;
 
-      if (w->color == red) {
-        w->color = black;
-        z->parent->color = red;
-        right_rotate(z->parent);
-        w = z->parent->left;
+  int stops = 1;
+
+  while (true) {
+    if (current == 0) {
+      // if the arrival station cannot be reached from the target station no path exists
+      if (distances[current] + ranges[target] < distances[target]) {
+        free(unoptimized);
+        return NULL;
       }
 
-      if (w->right->color == black && w->left->color == black) {
-        w->color = red;
-        z = z->parent;
-      } else {
-        if (w->left->color == black) {
-          w->right->color = black;
-          w->color = red;
-          left_rotate(w);
-          w = z->parent->left;
-        }
+      // otherwise, insert the last station
+      unoptimized[stops++] = current;
 
-        w->color = z->parent->color;
-        z->parent->color = black;
-        w->left->color = black;
-        right_rotate(z->parent);
-        z = root;
+      // the found path has the minimum number of nodes,
+      // but is not the best one, so needs to be optimized
+      return optimize(distances, ranges, unoptimized, stops);
+    }
+
+    current--;
+    // checks if the current station can be reached from the target one
+    // and if it has the best (minimum) score
+    if (
+        distances[current] + ranges[target] >= distances[target] &&
+        distances[current] - ranges[current] <= distances[best] - ranges[best] //
+        )
+      best = current;
+    else {
+      // checks if the current is the predecessor of the target
+      // or if the best station has already been inserted into the output array
+      if (current == target - 1 || best == unoptimized[stops - 1]) {
+        free(unoptimized);
+        return NULL;
       }
+
+      // otherwise insert the best node into the output array
+      unoptimized[stops++] = best;
+      target = best;
+      current = target;
     }
   }
-
-  z->color = black;
 }
 
 /**
- * @brief transplants the sub tree with root v in the sub tree with root u.
- * * DO NOT TOUCH! From Cormen book
+ * @brief plans the route from the given distance to the given distance.
  *
- * @param u the root of the sub tree where to transplant.
- * @param v the root of the sub tree to transplant.
+ * @param distance1 the distance from which to plan the route.
+ * @param distance2 the distance of the station to be reached.
+ * @return int* an array of distances indicating the stations where to stop and change car.
  */
-void transplant(station_t *u, station_t *v) {
-  if (u->parent == null_station)
-    root = v;
-  else if (u == u->parent->left)
-    u->parent->left = v;
+int *plan_route(int distance1, int distance2) {
+  // the route has no station or only one: it's impossible to plan a route.
+  if (number_of_stations < 2)
+    return NULL;
+
+  int *output = NULL;
+
+  // checks if the stations exists in the route.
+  if (get_from_table(distance1) == null_station || get_from_table(distance2) == null_station)
+    return NULL;
+
+  // if the given distances are the same
+  if (distance1 == distance2) {
+    output = malloc(sizeof(int) * 2);
+    output[0] = distance1;
+    output[1] = -1;
+
+    return output;
+  }
+
+  // the route may have been planned already, with no changes between its ends since
+  route_entry_t *entry = find_route(distance1, distance2);
+  if (entry != NULL)
+    return entry->route != NULL ? copy_route(entry->route) : NULL;
+
+  // a long enough sequence of plans freezes the stations, until they change again,
+  // once it has collected enough stations to pay for the copy
+  if (!frozen && freeze_threshold > 0 && ++consecutive_plans >= freeze_threshold &&
+      collected_in_a_row >= freeze_payoff * (long) number_of_stations)
+    freeze_stations();
+
+  // the window of the stations between the given ones, read from the frozen stations if any
+  int from = distance1 < distance2 ? distance1 : distance2,
+      to = distance1 < distance2 ? distance2 : distance1;
+  const int *distances, *ranges;
+  int length;
+  if (frozen) {
+    int first = search_frozen(from);
+    distances = &frozen_distances[first];
+    ranges = &frozen_ranges[first];
+    length = search_frozen(to) + 1 - first;
+  } else {
+    length = collect_stations(from, to);
+    distances = window_distances;
+    ranges = window_ranges;
+    collected_in_a_row += length;
+  }
+
+  // two different algorithms for forward and backward paths,
+  // both scanning the window of the stations between the given ones
+  if (distance1 < distance2)
+    output = explore_forward(distances, ranges, length);
   else
-    u->parent->right = v;
+    output = explore_backward(distances, ranges, length);
 
-  v->parent = u->parent;
+  remember_route(distance1, distance2, output);
+  return output;
 }
 
 /**
- * @brief adds the station at the given distance in the given route.
- * * DO NOT TOUCH! From Cormen book
+ * @brief pushes a block in the ring. only the producer of the ring can call it.
  *
- * @param distance the distance to add the station.
- * @return station_t* the added station, or NULL if already present.
+ * @param ring the ring where to push the block.
+ * @param block the block to push.
  */
-station_t *add_station(int distance) {
-  station_t *y = null_station;
-  station_t *x = root;
+void push_block(block_ring_t *ring, output_block_t *block) {
+  int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  ring->blocks[tail] = block;
+  atomic_store_explicit(&ring->tail, (tail + 1) % number_of_output_blocks, memory_order_release);
+  sem_post(&ring->count);
+}
 
-  while (x != NULL && x != null_station) {
-    // the station already exists
-    if (x->distance == distance)
-      return NULL;
+/**
+ * @brief pops a block from the ring. only the consumer of the ring can call it,
+ * after having decremented the semaphore of the ring.
+ *
+ * @param ring the ring from where to pop the block.
+ * @return output_block_t* the block popped.
+ */
+output_block_t *pop_block(block_ring_t *ring) {
+  int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  // pairs with the release of the producer, making the block visible
+  while (atomic_load_explicit(&ring->tail, memory_order_acquire) == head);
+
+  output_block_t *block = ring->blocks[head];
+  atomic_store_explicit(&ring->head, (head + 1) % number_of_output_blocks, memory_order_relaxed);
+  return block;
+}
 
-    y = x;
-    if (distance < x->distance)
-      x = x->left;
-    else
-      x = x->right;
+/**
+ * @brief writes the given blocks to the standard output with as few system calls as possible.
+ *
+ * @param blocks the blocks to write, in order.
+ * @param count the number of blocks.
+ */
+void write_blocks(output_block_t **blocks, int count) {
+  struct iovec vectors[number_of_output_blocks];
+  for (int i = 0; i < count; i++) {
+    vectors[i].iov_base = blocks[i]->data;
+    vectors[i].iov_len = blocks[i]->length;
   }
 
-  station_t *z = init_station(distance);
-  if (z != NULL) {
-    z->parent = y;
+  struct iovec *vector = vectors;
+  while (count > 0) {
+    ssize_t written = writev(STDOUT_FILENO, vector, count);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("stdout");
+      exit(1);
+    }
 
-    if (y == null_station)
-      root = z;
-    else if (distance < y->distance)
-      y->left = z;
-    else
-      y->right = z;
+    // skips the blocks written, and the written part of the last one
+    while (count > 0 && (size_t) written >= vector->iov_len) {
+      written -= (ssize_t) vector->iov_len;
+      vector++;
+      count--;
+    }
+    if (count > 0) {
+      vector->iov_base = (char *) vector->iov_base + written;
+      vector->iov_len -= written;
+    }
+  }
+}
 
-    z->color = red;
+/**
+ * @brief writes the filled blocks to the standard output, in order, and gives them back to the player.
+ * all the blocks filled in the meantime are written together. a NULL block ends the output.
+ *
+ * @param unused the argument of the thread.
+ * @return void* NULL.
+ */
+void *write_behind(void *unused) {
+  output_block_t *blocks[number_of_output_blocks];
+  boolean done = false;
+
+  while (!done) {
+    int count = 0;
+    sem_wait(&filled_blocks.count);
+    do {
+      output_block_t *block = pop_block(&filled_blocks);
+      if (block == NULL) {
+        done = true;
+        break;
+      }
+      blocks[count++] = block;
+    } while (count < number_of_output_blocks && sem_trywait(&filled_blocks.count) == 0);
 
-    insert_fixup(z);
-    return z;
+    write_blocks(blocks, count);
+    for (int i = 0; i < count; i++) {
+      blocks[i]->length = 0;
+      push_block(&written_blocks, blocks[i]);
+    }
   }
 
-  return null_station;
+  return NULL;
 }
 
 /**
- * @brief removes the station at the given distance in the given route.
- * * DO NOT TOUCH! From Cormen book
- *
- * @param distance the distance to remove the station at.
- * @return true if the station has been added successfully.
- * @return false otherwise.
+ * @brief starts the writer thread, moving the output to the blocks.
  */
-boolean remove_station(int distance) {
-  station_t *z = get_at(distance);
-  if (z == null_station)
-    return false;
+void start_writer() {
+  sem_init(&filled_blocks.count, 0, 0);
+  sem_init(&written_blocks.count, 0, 0);
 
-  station_t *y = z;
-  station_t *x = NULL;
-  color_t color = y->color;
+  output_block = (output_block_t *) malloc(sizeof(output_block_t));
+  output_block->data = output;
+  allocated_output_blocks = 1;
 
-  if (root == z && z->left == null_station && z->right == null_station) {
-    root = NULL;
-  } else if (z->left == null_station) {
-    x = z->right;
-    transplant(z, z->right);
-  } else if (z->right == null_station) {
-    x = z->left;
-    transplant(z, z->left);
-  } else {
-    y = get_minimum(z->right);
-    color = y->color;
-    x = y->right;
+  if (pthread_create(&writer, NULL, write_behind, NULL) != 0) {
+    perror("writer");
+    exit(1);
+  }
+  async_output = true;
+}
 
-    if (y->parent == z)
-      x->parent = y;
-    else {
-      transplant(y, y->right);
-      y->right = z->right;
-      y->right->parent = y;
+/**
+ * @brief gives the last block to the writer thread and waits for it to write all of them.
+ */
+void stop_writer() {
+  flush_output();
+  push_block(&filled_blocks, NULL);
+  pthread_join(writer, NULL);
+}
+
+/**
+ * @brief empties the output buffer: writes it to the standard output or, if the output is asynchronous,
+ * gives it to the writer thread and moves to a free block.
+ */
+void flush_output() {
+  if (async_output) {
+    output_block->length = output_length;
+    push_block(&filled_blocks, output_block);
+
+    // reuses a written block, or allocates a new one: waits for the writer only when
+    // all the blocks are already filled, to bound the memory of a blocked output
+    if (sem_trywait(&written_blocks.count) == 0)
+      output_block = pop_block(&written_blocks);
+    else if (allocated_output_blocks < number_of_output_blocks - 1) {
+      output_block = (output_block_t *) malloc(sizeof(output_block_t));
+      output_block->data = (char *) malloc(output_size);
+      allocated_output_blocks++;
+    } else {
+      sem_wait(&written_blocks.count);
+      output_block = pop_block(&written_blocks);
     }
 
-    transplant(z, y);
-    y->left = z->left;
-    y->left->parent = y;
-    y->color = z->color;
+    output = output_block->data;
+    output_length = 0;
+    return;
+  }
+
+  long written = 0;
+  while (written < output_length) {
+    ssize_t count = write(STDOUT_FILENO, output + written, output_length - written);
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count <= 0) {
+      perror("stdout");
+      exit(1);
+    }
+    written += count;
+  }
+
+  output_length = 0;
+}
+
+/**
+ * @brief makes room for the given number of bytes in the output buffer, flushing it if needed.
+ *
+ * @param length the number of bytes to be written.
+ */
+void reserve_output(long length) {
+  if (output_length + length > output_size)
+    flush_output();
+}
+
+/**
+ * @brief writes the decimal representation of the given integer in the output buffer.
+ * the digits are produced two at a time, from the last ones.
+ *
+ * @param value the integer to write.
+ */
+void write_int(int value) {
+  char digits[12];
+  int i = sizeof(digits);
+  unsigned magnitude = value < 0 ? -(unsigned) value : (unsigned) value;
+
+  while (magnitude >= 100) {
+    unsigned pair = magnitude % 100;
+    magnitude /= 100;
+    i -= 2;
+    memcpy(digits + i, digit_pairs + 2 * pair, 2);
+  }
+  if (magnitude >= 10) {
+    i -= 2;
+    memcpy(digits + i, digit_pairs + 2 * magnitude, 2);
+  } else
+    digits[--i] = (char) ('0' + magnitude);
+
+  if (value < 0)
+    digits[--i] = '-';
+
+  reserve_output(sizeof(digits));
+  memcpy(output + output_length, digits + i, sizeof(digits) - i);
+  output_length += (long) sizeof(digits) - i;
+}
+
+/**
+ * @brief writes the given integer in the output buffer as a varint.
+ *
+ * @param value the integer to write.
+ */
+void write_varint(int value) {
+  reserve_output(max_varint_length);
+  output_length += encode_varint(value, (unsigned char *) output + output_length);
+}
+
+/**
+ * @brief prints the response to a command.
+ *
+ * @param code the code of the response.
+ */
+void print_response(int code) {
+  reserve_output(16);
+
+  if (binary_protocol) {
+    output[output_length++] = (char) code;
+    return;
+  }
+
+  memcpy(output + output_length, response_lines[code].text, response_lines[code].length);
+  output_length += response_lines[code].length;
+}
+
+/**
+ * @brief prints a planned route.
+ *
+ * @param route the distances of the stations of the route, terminated by -1.
+ */
+void print_route(const int *route) {
+  if (binary_protocol) {
+    int length = 0;
+    while (route[length] != -1)
+      length++;
+
+    reserve_output(1);
+    output[output_length++] = route_code;
+    write_varint(length);
+    for (int i = 0; i < length; i++)
+      write_varint(route[i]);
+    return;
   }
 
-  if (color == black)
-    delete_fixup(x);
-
-  free(z->cars);
-  free(z);
-  return true;
+  for (int i = 0; route[i] != -1; i++) {
+    write_int(route[i]);
+    // separates the distances with a space, and ends the route with a new line.
+    // write_int reserves room for one more char than the longest integer
+    output[output_length++] = route[i + 1] != -1 ? ' ' : '\n';
+  }
 }
 
 /**
- * @brief adds the car in the given station with the given range.
+ * @brief adds the station and its cars.
  *
- * @param station the station where to add the car.
- * @param range the range of the car to be added.
- * @return true if the car has been added successfully.
- * @return false otherwise.
+ * @param operands the distance of the station, the number of cars and their ranges.
+ * @param count the number of operands.
  */
-boolean add_car(station_t *station, int range) {
-  if (station == NULL || station == null_station || station->number_of_cars == max_cars)
-    return false;
+void execute_add_station(const int *operands, int count) {
+  // the frozen stations would not see the change
+  thaw_stations();
 
-  // checks if the given range is grater than the maximum one in the given station
-  if (range > station->max_range)
-    station->max_range = range;
+  // adds the new station at the provided distance.
+  station_t *station = add_station(operands[0]);
+
+  // the station is already present in the route, or there is no memory for it.
+  if (station == NULL || station == null_station) {
+    print_response(not_added_code);
+    return;
+  }
 
-  // adds the car in last available position
-  station->cars[station->number_of_cars++] = range;
+  // caches the station, and forgets the routes across it.
+  cache_station(station);
+  invalidate_routes(operands[0]);
+  print_response(added_code);
 
-  return true;
+  // adds the provided number of cars in the station.
+  int number_of_cars = operands[1];
+  if (number_of_cars > count - 2)
+    number_of_cars = count - 2;
+  add_cars(station, &operands[2], number_of_cars);
 }
 
 /**
- * @brief removes the car with the given range from the given station.
+ * @brief adds a car to a station.
  *
- * @param station the station from which to remove the car.
- * @param range the range of the car to be removed.
- * @return true if the car has been removed successfully.
- * @return false otherwise.
+ * @param operands the distance of the station and the range of the car.
+ * @param count the number of operands.
  */
-boolean remove_car(station_t *station, int range) {
-  if (station == NULL || station == null_station || station->number_of_cars == 0)
-    return false;
-
-  // checks if the car exists in the array of cars and retrieves its index.
-  // this function sorts the array in descending order
-  int i = contains_car(station, range);
-  if (i != -1) {
-    // sets its range to 0 and swaps with the last available car
-    station->cars[i] = 0;
-    swap(station->cars, i, --station->number_of_cars);
+void execute_add_car(const int *operands, int count) {
+  // the frozen stations would not see the change
+  thaw_stations();
+
+  // retrieves the station from the cache, or searches it and caches it.
+  station_t *station = get_cached(operands[0]);
+  if (station == null_station) {
+    print_response(not_added_code);
+    return;
+  }
 
-    // fixes the maximum range available in the given station
-    if (i == 0)
-      station->max_range = station->cars[1];
-    else
-      station->max_range = station->cars[0];
+  // adds the car with the specified range in the station.
+  if (add_car(station, operands[1]))
+    print_response(added_code);
+  else
+    print_response(not_added_code);
+}
 
-    return true;
+/**
+ * @brief removes a car from a station.
+ *
+ * @param operands the distance of the station and the range of the car.
+ * @param count the number of operands.
+ */
+void execute_remove_car(const int *operands, int count) {
+  // the frozen stations would not see the change
+  thaw_stations();
+
+  // retrieves the station from the cache, or searches it and caches it.
+  station_t *station = get_cached(operands[0]);
+  if (station == null_station) {
+    print_response(not_scrapped_code);
+    return;
   }
 
-  return false;
+  // removes the car with the specified range from the station.
+  if (remove_car(station, operands[1]))
+    print_response(scrapped_code);
+  else
+    print_response(not_scrapped_code);
 }
 
 /**
- * @brief optimizes the given route to be minimal.
+ * @brief removes a station.
  *
- * @param unoptimized an unoptimized minimum path
- * @param length the length of the route
- * @return int* the minimum optimized path
+ * @param operands the distance of the station.
+ * @param count the number of operands.
  */
-int *optimize(station_t **unoptimized, int length) {
-  int i = length - 1;
-  station_t *current = unoptimized[i],
-      *target = unoptimized[i];
+void execute_remove_station(const int *operands, int count) {
+  // the frozen stations would not see the change
+  thaw_stations();
 
-  while (true) {
-    current = get_successor_of(current);
+  int distance = operands[0];
 
-    // reached the end of the array
-    if (current == unoptimized[0])
-      break;
+  // forgets the cached station if it is the one to remove, before it gets freed.
+  uncache_station(distance);
 
-    if (i >= 1 && current == unoptimized[i - 1]) {
-      target = current;
-      i--;
-      continue;
-    } else {
-      // checks if the current station can reach the target one and
-      // if it can be reached from the next station in the array.
-      if (
-          i >= 2 && current->distance - current->max_range <= target->distance &&
-          unoptimized[i - 2]->distance - unoptimized[i - 2]->max_range <= current->distance &&
-          current->distance < unoptimized[i - 1]->distance //
-          ) {
-        // inserts the node in the output array, replacing the unoptimized one.
-        unoptimized[i - 1] = current;
-        current = unoptimized[i - 1];
-        target = current;
-        i--;
+  // checks if the remove_station function does indeed remove the station.
+  if (remove_station(distance)) {
+    invalidate_routes(distance);
+    print_response(removed_code);
+  } else
+    print_response(not_removed_code);
+}
 
-      } else
-        continue;
-    }
-  }
+/**
+ * @brief plans the route between two stations and prints it.
+ *
+ * @param operands the distances of the departure and of the arrival stations.
+ * @param count the number of operands.
+ */
+void execute_plan_route(const int *operands, int count) {
+  int *planned_route = plan_route(operands[0], operands[1]);
 
-  // inserts all the distances in the output array (including -1 as a delimiter)
-  int *output = (int *) malloc(sizeof(int) * (length + 1));
-  for (int j = 0; j <= length; j++) {
-    output[j] = unoptimized[j]->distance;
+  // if no path exists
+  if (planned_route == NULL) {
+    print_response(no_route_code);
+    return;
   }
 
-  free(unoptimized);
-  return output;
+  print_route(planned_route);
+  free(planned_route);
 }
 
 /**
- * @brief explores the minimum path from station1 to station2 in the given route.
- * this is called when the distance of station1 is smaller than the station2 distance.
- * it takes advantage of the fact that the chosen stations must have the smallest distance from the origin.
- *
- * @param station1 the first station.
- * @param station2 the second station.
- * @return int* the minimum path from station1 to station2.
+ * @brief fills the dispatch table, placing every command at the slot given by the hash of its name.
  */
-int *explore_forward(station_t *station1, station_t *station2) {
-  station_t *current = station2,
-      *best = station2,
-      *target = station2;
+void init_commands() {
+  const command_t all[] = {
+      {add_station_msg, sizeof(add_station_msg) - 1, add_station_op, 2, execute_add_station},
+      {remove_station_msg, sizeof(remove_station_msg) - 1, remove_station_op, 1, execute_remove_station},
+      {add_car_msg, sizeof(add_car_msg) - 1, add_car_op, 2, execute_add_car},
+      {remove_car_msg, sizeof(remove_car_msg) - 1, remove_car_op, 2, execute_remove_car},
+      {plan_route_msg, sizeof(plan_route_msg) - 1, plan_route_op, 2, execute_plan_route},
+  };
+
+  for (int i = 0; i < (int) (sizeof(all) / sizeof(all[0])); i++) {
+    command_t *entry = &commands[command_hash(all[i].name, all[i].length)];
+    *entry = all[i];
+    binary_commands[entry->opcode] = entry;
+  }
+}
 
-  int *output = (int *) malloc(sizeof(int));
-  output[0] = station2->distance;
-  int length = 1;
+/**
+ * @brief finds the command with the given name.
+ * the hash of the name selects the only command it can be, so unknown commands are rejected by a single comparison.
+ *
+ * @param command the name of the command.
+ * @param length the number of chars of the name.
+ * @return const command_t* the command, or NULL if the name is unknown.
+ */
+const command_t *get_command(const char *command, int length) {
+  if (command == NULL || length < min_command_length || length > max_command_length)
+    return NULL;
 
-  while (true) {
-    // finds the best node that can reach the target station
-    while (current != station1) {
-      current = get_predecessor_of(current);
-      if (current->distance + current->max_range >= target->distance)
-        best = current;
-    }
+  const command_t *entry = &commands[command_hash(command, length)];
+  if (entry->length != length || memcmp(command, entry->name, length) != 0)
+    return NULL;
 
-    // if the best node is the target one, no path exists
-    if (best == target) {
-      free(output);
-      return NULL;
-    }
+  return entry;
+}
 
-    // otherwise insert the best station in the output array
-    output = (int *) realloc(output, sizeof(int) * (length + 1));
-    output[length++] = best->distance;
+/**
+ * @brief reads the next byte of the input.
+ *
+ * @return int the byte read, or EOF if there are no more bytes.
+ */
+int next_byte() {
+  while (input_cursor >= input_end)
+    if (!next_chunk())
+      return EOF;
 
-    // if the best node is the arrival station, it found the best path
-    if (best == station1) {
-      // sorts in ascending order
-      qsort(output, length, sizeof(int), ascending);
-      // inserts in the output array -1 as a delimiter
-      output = (int *) realloc(output, sizeof(int) * (length + 1));
-      output[length] = -1;
+  return (unsigned char) *input_cursor++;
+}
 
-      return output;
+/**
+ * @brief reads an unsigned LEB128 varint from the input.
+ *
+ * @param value where to store the integer read.
+ * @return int 1 if the integer has been read, 0 if the input ended before its last byte.
+ */
+int read_varint(int *value) {
+  unsigned result = 0;
+  for (int shift = 0; shift < 7 * max_varint_length; shift += 7) {
+    int byte = next_byte();
+    if (byte == EOF)
+      return 0;
+
+    result |= (unsigned) (byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = (int) result;
+      return 1;
     }
-
-    target = best;
-    current = best;
   }
+
+  // too many bytes for a 32 bit integer
+  return 0;
 }
 
 /**
- * @brief explores the minimum path from station1 to station2 in the given route.
- * this is called when the distance of station1 is grater than the distance of station2.
+ * @brief checks whether the input follows the binary protocol, consuming its magic bytes if so.
+ * the text protocol can never start with the first magic byte, so a single byte is enough to tell them apart.
  *
- * @param station1 the first station.
- * @param station2 the second station.
- * @return int* the minimum path from station1 to station2.
+ * @return int 1 if the input is binary, 0 if it is text, -1 if it starts as binary but the magic bytes are wrong.
  */
-int *explore_backward(station_t *station1, station_t *station2) {
-  station_t *current = station1,
-      *target = station1,
-      *best = station1;
+int detect_binary_input() {
+  int byte = next_byte();
+  if (byte == EOF)
+    return 0;
+
+  if (byte != (unsigned char) binary_magic[0]) {
+    // gives the byte back to the text protocol
+    input_cursor--;
+    return 0;
+  }
 
-  station_t **unoptimized = malloc(sizeof(station_t));
-  unoptimized[0] = station1;
+  // the binary commands are read byte by byte, so the chunks need not end with a whole line
+  atomic_store(&whole_lines, 0);
 
-  int length = 1;
+  for (int i = 1; i < binary_magic_length; i++)
+    if (next_byte() != (unsigned char) binary_magic[i])
+      return -1;
 
-  while (true) {
-    if (current == station2) {
-      // if the arrival station cannot be reached from the target station no path exists
-      if (current->distance + target->max_range < target->distance) {
-        free(unoptimized);
-        return NULL;
+  return 1;
+}
+
+/**
+ * @brief reads the commands of the binary protocol and calls the appropriate methods.
+ */
+void play_binary() {
+  int opcode;
+  while ((opcode = next_byte()) != EOF) {
+    if (opcode == 0 || opcode > max_opcode) {
+      fprintf(stderr, "invalid opcode %d\n", opcode);
+      return;
+    }
+
+    // reads the fixed operands, plus the ranges of the cars of a new station
+    const command_t *entry = binary_commands[opcode];
+    int count = entry->arity;
+    int *fields = line_scanner.fields;
+    unsigned cars = 0;
+    for (int i = 0; i < count; i++) {
+      if (i == line_scanner.capacity) {
+        grow_fields(&line_scanner);
+        fields = line_scanner.fields;
       }
 
-      // otherwise, insert the last station and the null station as a delimiter
-      unoptimized = realloc(unoptimized, sizeof(station_t) * (length + 2));
-      unoptimized[length++] = current;
-      unoptimized[length] = null_station;
+      if (!read_varint(&fields[i])) {
+        fprintf(stderr, "truncated command\n");
+        return;
+      }
 
-      // the found path has the minimum number of nodes,
-      // but is not the best one, so needs to be optimized
-      return optimize(unoptimized, length);
+      // only the first max_cars cars are kept, as a station cannot hold more
+      if (opcode == add_station_op && i == 1) {
+        cars = (unsigned) fields[1];
+        count += cars < max_cars ? (int) cars : max_cars;
+      }
     }
 
-    current = get_predecessor_of(current);
-    // checks if the current station can be reached from the target one
-    // and if it has the best (minimum) score
-    if (
-        current->distance + target->max_range >= target->distance &&
-        current->distance - current->max_range <= best->distance - best->max_range //
-        )
-      best = current;
-    else {
-      // checks if the current is the predecessor of the target
-      // or if the best station has already been inserted into the output array
-      if (current == get_predecessor_of(target) || best == unoptimized[length - 1]) {
-        free(unoptimized);
-        return NULL;
+    // the cars beyond max_cars are still read, so that the next command starts where it should
+    for (unsigned i = max_cars; i < cars; i++) {
+      int skipped;
+      if (!read_varint(&skipped)) {
+        fprintf(stderr, "truncated command\n");
+        return;
       }
-
-      // otherwise insert the best node into the output array
-      unoptimized = realloc(unoptimized, sizeof(station_t) * (length + 1));
-      unoptimized[length++] = best;
-      target = best;
-      current = target;
     }
+
+    entry->execute(fields, count);
   }
 }
 
 /**
- * @brief plans the route from the given distance to the given distance.
+ * @brief moves the input to its next window: a run of whole lines to be parsed at once.
  *
- * @param distance1 the distance from which to plan the route.
- * @param distance2 the distance of the station to be reached.
- * @return int* an array of distances indicating the stations where to stop and change car.
+ * @param start where to store the start of the window.
+ * @param end where to store the end of the window.
+ * @param limit where to store the end of the memory that can be safely read past the window.
+ * @return int 1 if the input moved to the next window, 0 if there are no more lines.
  */
-int *plan_route(int distance1, int distance2) {
-  // the route has no station or only one: it's impossible to plan a route.
-  if (root == NULL || (root->right == null_station && root->left == null_station))
-    return NULL;
-
-  int *output = NULL;
-
-  // checks if the stations exists in the route.
-  station_t *station1 = get_at(distance1),
-      *station2 = get_at(distance2);
-  if (station1 == null_station || station2 == null_station)
-    return NULL;
-
-  // if the given distances are the same
-  if (distance1 == distance2) {
-    output = malloc(sizeof(int) * 2);
-    output[0] = distance1;
-    output[1] = -1;
-
-    return output;
+int next_window(char **start, char **end, const char **limit) {
+  while (input_cursor >= input_end)
+    if (!next_chunk())
+      return 0;
+
+  // a chunk is a window by itself, while the memory mapped input gets split on the first new line after the window size
+  char *window_end = input_end;
+  if (input_end - input_cursor > parse_window_size) {
+    char *new_line = memchr(input_cursor + parse_window_size, '\n', input_end - input_cursor - parse_window_size);
+    if (new_line != NULL)
+      window_end = new_line + 1;
   }
 
-  // two different algorithms for forward and backward paths
-  if (distance1 < distance2)
-    output = explore_forward(station1, station2);
-  else
-    output = explore_backward(station1, station2);
-
-  return output;
+  *start = input_cursor;
+  *end = window_end;
+  *limit = input_readable_end;
+  input_cursor = window_end;
+  return 1;
 }
 
 /**
- * @brief reads the input from stdin and calls the appropriate methods.
+ * @brief decodes the commands of a segment of the input, skipping the ones that would be ignored when played.
+ *
+ * @param argument the job of the segment.
+ * @return void* NULL.
  */
-void play() {
-  // flushes the standard input.
-  fflush(stdin);
+void *parse_segment(void *argument) {
+  parse_job_t *job = (parse_job_t *) argument;
+  job->scanner.number_of_fields = 0;
+  job->number_of_commands = 0;
+
+  char *line = job->start;
+  while (line < job->end) {
+    char *new_line = memchr(line, '\n', job->end - line);
+    // nothing can be read past the last line of the input, if it has no trailing new line
+    char *end = new_line != NULL ? new_line + 1 : job->end;
+    const char *limit = new_line != NULL ? job->limit : job->end;
+
+    int first = job->scanner.number_of_fields;
+    int length;
+    char *command = scan_line(&job->scanner, line, end, limit, &length);
+    const command_t *entry = get_command(command, length);
+    line = end;
+
+    // drops the unknown commands and the ones with missing operands, along with their fields
+    if (entry == NULL || job->scanner.number_of_fields - first < entry->arity) {
+      job->scanner.number_of_fields = first;
+      continue;
+    }
 
-  // the input tends to repeat multiple operations to the same station,
-  // so cache the last added station to avoid searching for it again.
-  station_t *cached = null_station;
+    if (job->number_of_commands == job->commands_capacity) {
+      job->commands_capacity = job->commands_capacity == 0 ? 1024 : job->commands_capacity * 2;
+      job->commands = (decoded_command_t *) realloc(job->commands, sizeof(decoded_command_t) * job->commands_capacity);
+    }
 
-  // pointer to the first element of the buffer
-  // in order to reset it before fetching another command.
-  char *temp = buffer;
+    decoded_command_t *decoded = &job->commands[job->number_of_commands++];
+    decoded->opcode = entry->opcode;
+    decoded->count = job->scanner.number_of_fields - first;
+    decoded->first = first;
+  }
 
-  // game main loop
-  while (true) {
-    // resets the buffer.
-    buffer = temp;
+  return NULL;
+}
 
-    // if no more commands retrieved from standard input,
-    // the program must terminate.
-    if (fgets(buffer, buffer_size, stdin) == NULL)
-      break;
+/**
+ * @brief splits a window of the input on new lines, and starts a parser thread on every segment.
+ *
+ * @param jobs the jobs of the parser threads.
+ * @param start the start of the window.
+ * @param end the end of the window.
+ * @param limit the end of the memory that can be safely read past the window.
+ */
+void start_parsers(parse_job_t *jobs, char *start, char *end, const char *limit) {
+  char *segment = start;
+  for (int i = 0; i < parser_threads; i++) {
+    parse_job_t *job = &jobs[i];
+
+    // the segments are about the same size, each one ending with a whole line
+    char *segment_end = end;
+    if (i < parser_threads - 1) {
+      char *boundary = start + (end - start) / parser_threads * (i + 1);
+      if (boundary < segment)
+        boundary = segment;
+
+      char *new_line = memchr(boundary, '\n', end - boundary);
+      if (new_line != NULL)
+        segment_end = new_line + 1;
+    }
 
-    // gets the current command from input
-    char *command = get_token();
+    job->start = segment;
+    job->end = segment_end;
+    job->limit = limit;
+    job->running = pthread_create(&job->thread, NULL, parse_segment, job) == 0;
+    // parses the segment in place if no thread can be started
+    if (!job->running)
+      parse_segment(job);
 
-    // adds station
-    if (strcmp(command, add_station_msg) == 0) {
-      // adds the new station at the provided distance.
-      int distance = atoi(get_token());
-      station_t *station = add_station(distance);
+    segment = segment_end;
+  }
+}
 
-      // the station is already present in the route.
-      if (station == NULL) {
-        puts(not_added_msg);
-        continue;
-      }
+/**
+ * @brief waits for the parser threads to decode their segments.
+ *
+ * @param jobs the jobs of the parser threads.
+ */
+void join_parsers(parse_job_t *jobs) {
+  for (int i = 0; i < parser_threads; i++)
+    if (jobs[i].running) {
+      pthread_join(jobs[i].thread, NULL);
+      jobs[i].running = false;
+    }
+}
 
-      // caches the station.
-      cached = station;
-      puts(added_msg);
+/**
+ * @brief frees the jobs of the parser threads, along with the commands and the fields they decoded.
+ *
+ * @param jobs the jobs of the parser threads, which must have been joined.
+ */
+void free_parsers(parse_job_t *jobs) {
+  for (int i = 0; i < parser_threads; i++) {
+    free(jobs[i].commands);
+    free(jobs[i].scanner.fields);
+  }
 
-      // adds the provided number of cars in the station.
-      int number_of_cars = atoi(get_token());
-      for (int i = 0; i < number_of_cars; i++) {
-        int range = atoi(get_token());
-        add_car(station, range);
-      }
+  free(jobs);
+}
 
-      continue;
+/**
+ * @brief calls the appropriate methods for the commands decoded by the parser threads, in order.
+ *
+ * @param jobs the jobs of the parser threads.
+ */
+void play_decoded(parse_job_t *jobs) {
+  for (int i = 0; i < parser_threads; i++) {
+    const parse_job_t *job = &jobs[i];
+    const decoded_command_t *commands = job->commands;
+    const int *fields = job->scanner.fields;
+
+    for (int j = 0; j < job->number_of_commands; j++) {
+      // resolves the stations of the next cars commands in two steps, a slot of the hash table first and then
+      // the station it points to, so that their cache misses overlap with the execution of the current commands
+      int ahead = j + 2 * prefetch_distance;
+      if (ahead < job->number_of_commands && cars_command(&commands[ahead]))
+        prefetch_slot(fields[commands[ahead].first]);
+
+      ahead = j + prefetch_distance;
+      if (ahead < job->number_of_commands && cars_command(&commands[ahead]))
+        prefetch_station(fields[commands[ahead].first]);
+
+      binary_commands[commands[j].opcode]->execute(fields + commands[j].first, commands[j].count);
     }
+  }
+}
 
-    // adds car
-    if (strcmp(command, add_car_msg) == 0) {
-      station_t *station;
-      int distance = atoi(get_token());
-
-      // retrieves the cached station instead of searching it
-      // if the provided distance is the same.
-      if (distance == cached->distance)
-        station = cached;
-      else {
-        // if it's not the same, searches the new station and caches it.
-        station = get_at(distance);
-        if (station == null_station) {
-          puts(not_added_msg);
-          continue;
-        }
-
-        cached = station;
-      }
-
-      // adds the car with the specified range in the station.
-      int range = atoi(get_token());
-      if (add_car(station, range))
-        puts(added_msg);
-      else
-        puts(not_added_msg);
+/**
+ * @brief reads the text input through the parser threads and calls the appropriate methods.
+ * the commands of a window of the input are played while the parser threads decode the next one,
+ * so that the player never has to tokenize the text.
+ */
+void play_parallel() {
+  // the commands of a set of jobs are played while the other set is parsed
+  parse_job_t *jobs[2];
+  jobs[0] = (parse_job_t *) calloc(parser_threads, sizeof(parse_job_t));
+  jobs[1] = (parse_job_t *) calloc(parser_threads, sizeof(parse_job_t));
+
+  char *start, *end;
+  const char *limit;
+  if (!next_window(&start, &end, &limit)) {
+    free_parsers(jobs[0]);
+    free_parsers(jobs[1]);
+    return;
+  }
 
-      continue;
-    }
+  int parsed = 0;
+  start_parsers(jobs[parsed], start, end, limit);
+  join_parsers(jobs[parsed]);
 
-    // removes car
-    if (strcmp(command, remove_car_msg) == 0) {
-      station_t *station;
-      int distance = atoi(get_token());
-
-      // retrieves the cached station instead of searching it
-      // if the provided distance is the same.
-      if (distance == cached->distance)
-        station = cached;
-      else {
-        // if it's not the same, searches the new station and caches it.
-        station = get_at(distance);
-        if (station == null_station) {
-          puts(not_scrapped_msg);
-          continue;
-        }
+  while (true) {
+    // the window just parsed is not needed anymore, so the input can move past it
+    boolean more = next_window(&start, &end, &limit);
+    if (more)
+      start_parsers(jobs[1 - parsed], start, end, limit);
 
-        cached = station;
-      }
+    play_decoded(jobs[parsed]);
 
-      // removes the car with the specified range from the station.
-      int range = atoi(get_token());
-      if (remove_car(station, range))
-        puts(scrapped_msg);
-      else
-        puts(not_scrapped_msg);
+    if (!more)
+      break;
 
-      continue;
-    }
+    join_parsers(jobs[1 - parsed]);
+    parsed = 1 - parsed;
+  }
 
-    // removes station
-    if (strcmp(command, remove_station_msg) == 0) {
-      int distance = atoi(get_token());
+  free_parsers(jobs[0]);
+  free_parsers(jobs[1]);
+}
 
-      // checks if the remove_station function does indeed remove the station
-      // and if the cached one is the same as the one removed.
-      if (remove_station(distance)) {
-        puts(removed_msg);
-        if (distance == cached->distance)
-          cached = null_station;
-      } else
-        puts(not_removed_msg);
+/**
+ * @brief reads the input and calls the appropriate methods.
+ */
+void play() {
+  // the length of the command read
+  int length;
 
-      continue;
-    }
+  if (binary_protocol) {
+    play_binary();
+    return;
+  }
 
-    // plans route
-    if (strcmp(command, plan_route_msg) == 0) {
-      int distance1 = atoi(get_token());
-      int distance2 = atoi(get_token());
-      int *planned_route = plan_route(distance1, distance2);
+  if (parser_threads > 0) {
+    play_parallel();
+    return;
+  }
 
-      // if no path exists
-      if (planned_route == NULL) {
-        puts(no_route_msg);
-        continue;
-      }
+  // game main loop
+  while (true) {
+    // if no more commands retrieved from the input,
+    // the program must terminate.
+    if (!next_line())
+      break;
 
-      // prints the planned route
-      int i = 1;
-      while (planned_route[i] != -1) {
-        printf("%d ", planned_route[i - 1]);
-        i++;
-      }
-      printf("%d\n", planned_route[i - 1]);
+    // gets the current command from input
+    line_scanner.number_of_fields = 0;
+    char *command = scan_line(&line_scanner, buffer, line_end, input_limit, &length);
+    const command_t *entry = get_command(command, length);
 
-      free(planned_route);
+    // skips the unknown commands and the ones with missing operands
+    if (entry == NULL || line_scanner.number_of_fields < entry->arity)
       continue;
-    }
+
+    entry->execute(line_scanner.fields, line_scanner.number_of_fields);
   }
 }
 
 /**
  * @brief program execution entry point.
  *
+ * @param argc the number of arguments.
+ * @param argv the arguments: -a to write the output on a separate thread, -j followed by
+ * the number of threads parsing the text input ahead of the player, -c followed by the number
+ * of stations of the cache, -r followed by the number of routes of the route cache, -s to print
+ * the statistics of the caches on the standard error and,
+ * optionally, the path of the file to read the commands from.
  * @return int 0 if the program successfully executed.
  */
-int main() {
-  // initializes the input buffer
-  buffer = (char *) malloc(buffer_size);
-  // initializes the leaf node of the RB tree
+int main(int argc, char **argv) {
+  boolean asynchronous = false;
+  boolean statistics = false;
+  int cache_size = default_cache_size;
+  int routes = default_route_cache_size;
+
+  int option;
+  boolean valid = true;
+  while ((option = getopt(argc, argv, "aj:c:r:sf:")) != -1) {
+    switch (option) {
+      case 'a':
+        asynchronous = true;
+        break;
+      case 'j':
+        parser_threads = atoi(optarg);
+        if (parser_threads < 0)
+          valid = false;
+        break;
+      case 'c':
+        cache_size = atoi(optarg);
+        if (cache_size < 0)
+          valid = false;
+        break;
+      case 'r':
+        routes = atoi(optarg);
+        if (routes < 0)
+          valid = false;
+        break;
+      case 's':
+        statistics = true;
+        break;
+      case 'f':
+        freeze_threshold = atoi(optarg);
+        if (freeze_threshold < 0)
+          valid = false;
+        break;
+      default:
+        valid = false;
+    }
+  }
+
+  if (!valid) {
+    fprintf(stderr, "usage: %s [-a] [-j threads] [-c cache size] [-r routes] [-s] [-f plans] [input]\n", argv[0]);
+    return 1;
+  }
+
+  // opens the input file given as argument, or the standard input
+  const char *path = optind < argc ? argv[optind] : NULL;
+  if (open_input(path) == -1) {
+    perror(path != NULL ? path : "stdin");
+    return 1;
+  }
+
+  // initializes the leaf node of the RB tree, the first station of the arena
   null_station = init_station(-1);
+  if (null_station == NULL) {
+    fprintf(stderr, "cannot reserve the memory of the stations\n");
+    return 1;
+  }
+  // initializes the station cache
+  init_cache(cache_size);
+  // initializes the route cache
+  init_route_cache(routes);
+  // initializes the command dispatch table
+  init_commands();
+  // selects the protocol of the input and of the output
+  int binary = detect_binary_input();
+  if (binary == -1) {
+    fprintf(stderr, "invalid binary input\n");
+    return 1;
+  }
+  binary_protocol = binary;
+  // initializes the output buffer, and the writer thread if requested
+  output = (char *) malloc(output_size);
+  if (asynchronous)
+    start_writer();
   // initializes the game
   play();
 
+  if (async_output)
+    stop_writer();
+  else
+    flush_output();
+
+  if (statistics) {
+    fprintf(stderr, "station cache: %d stations, %lu hits, %lu misses\n",
+            cache_sets * cache_ways, cache_hits, cache_misses);
+    fprintf(stderr, "route cache: %d routes, %lu hits, %lu misses\n",
+            route_cache_size, route_hits, route_misses);
+    fprintf(stderr, "arena: %ld kB committed, %ld kB backed by huge pages\n",
+            (long) (arena_cursor - arena) / 1024, huge_page_memory());
+  }
+
   return 0;
 }
\ No newline at end of file
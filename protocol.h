@@ -0,0 +1,90 @@
+#ifndef PROGETTO_API_PROTOCOL_H
+#define PROGETTO_API_PROTOCOL_H
+
+/*** TEXT PROTOCOL ***/
+
+#define add_station_msg "aggiungi-stazione"
+#define remove_station_msg "demolisci-stazione"
+#define add_car_msg "aggiungi-auto"
+#define remove_car_msg "rottama-auto"
+#define plan_route_msg "pianifica-percorso"
+
+#define added_msg "aggiunta"
+#define not_added_msg "non aggiunta"
+#define removed_msg "demolita"
+#define not_removed_msg "non demolita"
+#define scrapped_msg "rottamata"
+#define not_scrapped_msg "non rottamata"
+#define no_route_msg "nessun percorso"
+
+/*** BINARY PROTOCOL ***/
+
+/*
+ * a binary input starts with the bytes of binary_magic, followed by the commands.
+ * every command is an opcode byte followed by its operands, each one encoded as an unsigned
+ * LEB128 varint (7 bits per byte, least significant first, high bit set on every byte but the last):
+ *
+ *   add_station_op     distance, number of cars, range of every car
+ *   remove_station_op  distance
+ *   add_car_op         distance, range
+ *   remove_car_op      distance, range
+ *   plan_route_op      distance1, distance2
+ *
+ * the response to every command is a single code byte. the route_code is followed by
+ * the number of stations of the planned route and their distances, encoded as varints.
+ */
+
+// the first byte is not printable, so that a binary input can never be mistaken for a text one
+#define binary_magic "\xA9" "API"
+#define binary_magic_length 4
+
+#define add_station_op 1
+#define remove_station_op 2
+#define add_car_op 3
+#define remove_car_op 4
+#define plan_route_op 5
+#define max_opcode 5
+
+#define added_code 1
+#define not_added_code 2
+#define removed_code 3
+#define not_removed_code 4
+#define scrapped_code 5
+#define not_scrapped_code 6
+#define no_route_code 7
+#define route_code 8
+#define max_code 8
+
+// maximum number of bytes of a varint encoding a 32 bit integer
+#define max_varint_length 5
+
+// the text messages corresponding to the response codes
+static const char *const response_messages[] = {
+    [added_code] = added_msg,
+    [not_added_code] = not_added_msg,
+    [removed_code] = removed_msg,
+    [not_removed_code] = not_removed_msg,
+    [scrapped_code] = scrapped_msg,
+    [not_scrapped_code] = not_scrapped_msg,
+    [no_route_code] = no_route_msg,
+};
+
+/**
+ * @brief encodes the given integer as an unsigned LEB128 varint.
+ *
+ * @param value the integer to encode.
+ * @param output where to write the encoding, at least max_varint_length bytes.
+ * @return int the number of bytes written.
+ */
+static inline int encode_varint(unsigned value, unsigned char *output) {
+  int length = 0;
+  while (value >= 0x80) {
+    output[length++] = (unsigned char) (value | 0x80);
+    value >>= 7;
+  }
+  output[length++] = (unsigned char) value;
+
+  return length;
+}
+
+#endif //PROGETTO_API_PROTOCOL_H
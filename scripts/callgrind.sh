@@ -14,7 +14,7 @@ extension="${file_name##*.}"
 file_name="${file_name%.*}"
 
 # compile c file
-gcc -Wall -Werror -Wmaybe-uninitialized -Wuninitialized -pedantic -g3 -o $base_folder$file_name $c_file
+gcc -Wall -Werror -Wmaybe-uninitialized -Wuninitialized -pedantic -g3 -pthread -o $base_folder$file_name $c_file
 
 # executes callgrind tool on the executable file produced by the compile.sh script
 valgrind --tool=callgrind "$base_folder"./$file_name < $input_file > $output_folder$file_name.output.txt
@@ -0,0 +1,71 @@
+#!/bin/bash
+
+# base folder from where execution starts
+base_folder="$(cd "$(dirname "$0")/.." && pwd)/"
+output_folder=$(mktemp -d)"/"
+input_folder=$base_folder"opens/"
+
+# Provide the name of the C file as the first argument, and optionally the flags
+# to find the compression libraries (e.g. -I/usr/local/include) as the following ones
+c_file=$base_folder$1
+file_name=$(basename "$c_file")
+file_name="${file_name%.*}"
+shift
+
+# compile c file with both gzip and zstd inputs
+gcc -Wall -Werror -Wmaybe-uninitialized -Wuninitialized -pedantic -g -O0 -pthread -Dhave_zlib -Dhave_zstd "$@" \
+  -o $output_folder$file_name $c_file -lz -lzstd || exit 1
+
+total_tests=0
+passed=0
+
+# function that compares the output to the given test case
+function compare {
+  ((total_tests++))
+  diff -q "$1" "$2" &>/dev/null
+    if [ $? -eq 0 ]; then
+      echo -e "\e[32mTest $3: PASSED\e[0m"
+      ((passed++))
+    else
+      echo -e "\e[31mTest $3: FAILED\e[0m"
+    fi
+}
+
+# sends the compressed input through a pipe that stalls after the given number of bytes,
+# so that the program has used all the bytes received before the rest of them arrive
+function stalled_pipe {
+  head -c "$2" "$1"
+  sleep 1
+  tail -c +$(($2 + 1)) "$1"
+}
+
+for i in 1 50 100; do
+  input_file=$input_folder"open_$i.txt"
+  # the compressed inputs must give the same output as the plain one
+  expected_output=$output_folder"expected.output.txt"
+  "$output_folder"./"$file_name" < $input_file > $expected_output
+
+  gzip -c $input_file > $output_folder"input.gz"
+  zstd -q -c $input_file > $output_folder"input.zst"
+  # two gzip members, one after the other
+  cat $output_folder"input.gz" $output_folder"input.gz" > $output_folder"double.gz"
+  cat $input_file $input_file > $output_folder"double.txt"
+  "$output_folder"./"$file_name" < $output_folder"double.txt" > $output_folder"double.output.txt"
+
+  for compressed in input.gz input.zst; do
+    # inside the header, and inside the compressed data
+    for stall in 10 1000; do
+      stalled_pipe $output_folder$compressed $stall | "$output_folder"./"$file_name" > $output_folder"output.txt"
+      compare $expected_output $output_folder"output.txt" "$i $compressed stalled after $stall bytes"
+    done
+  done
+
+  stalled_pipe $output_folder"double.gz" $(stat -c %s $output_folder"input.gz") |
+    "$output_folder"./"$file_name" > $output_folder"output.txt"
+  compare $output_folder"double.output.txt" $output_folder"output.txt" "$i gzip members stalled in between"
+done
+
+echo "TEST PASSED: $((passed * 100 / total_tests))%"
+
+# Removes the executable file and the outputs
+rm -r $output_folder
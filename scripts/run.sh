@@ -14,7 +14,7 @@ extension="${file_name##*.}"
 file_name="${file_name%.*}"
 
 # compile c file
-gcc -Wall -Werror -Wmaybe-uninitialized -Wuninitialized -pedantic -g -O0 -o $base_folder$file_name $c_file
+gcc -Wall -Werror -Wmaybe-uninitialized -Wuninitialized -pedantic -g -O0 -pthread -o $base_folder$file_name $c_file
 
 # Run the executable with input redirection
 "$base_folder"./"$file_name" < $base_folder$input_file > $output_folder$file_name.output.txt
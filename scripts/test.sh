@@ -15,7 +15,7 @@ extension="${file_name##*.}"
 file_name="${file_name%.*}"
 
 # compile c file
-gcc -Wall -Werror -Wmaybe-uninitialized -Wuninitialized -pedantic -g -O0 -o $base_folder$file_name $c_file
+gcc -Wall -Werror -Wmaybe-uninitialized -Wuninitialized -pedantic -g -O0 -pthread -o $base_folder$file_name $c_file
 
 # function that compares the output to the given test case
 function compare {
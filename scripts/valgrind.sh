@@ -14,7 +14,7 @@ extension="${file_name##*.}"
 file_name="${file_name%.*}"
 
 # compile c file
-gcc -Wall -Werror -Wmaybe-uninitialized -Wuninitialized -pedantic -g3 -o $base_folder$file_name $c_file
+gcc -Wall -Werror -Wmaybe-uninitialized -Wuninitialized -pedantic -g3 -pthread -o $base_folder$file_name $c_file
 
 # executes valgrind tool on the executable file produced by the compile.sh script
 valgrind --leak-check=full --track-origins=yes --show-leak-kinds=all -s "$base_folder"./$file_name < $input_file > $base_folder'outputs/'$file_name.output.txt
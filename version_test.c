@@ -0,0 +1,150 @@
+/*
+ * checks that a pinned version of the persistent tree can be planned on from another thread while the
+ * stations keep changing: every plan on the pinned version must give the route planned before the changes.
+ *
+ *   version_test      exits with 0 if every plan matched, 1 otherwise
+ */
+
+#define station_index persistent_tree_index
+// the engine is included whole, so that the test reaches its functions
+#define main engine_main
+#include "main.c"
+#undef main
+
+#define test_stations 4000
+#define test_queries 256
+#define test_rounds 64
+
+/**
+ * @brief query planned on the pinned version, with the route it must give
+ */
+typedef struct query {
+  int distance1;
+  int distance2;
+  int *expected;
+} query_t;
+
+query_t queries[test_queries];
+// the version pinned for the planner thread, which unpins it when it is done
+version_node_t *pinned = NULL;
+atomic_int planner_done = 0;
+int mismatches = 0;
+
+/*** FUNCTION DECLARATION ***/
+int random_below(unsigned *, int);
+
+boolean same_route(const int *, const int *);
+
+void *plan_pinned(void *);
+
+/*** FUNCTION DEFINITION ***/
+
+/**
+ * @brief draws a pseudo random number.
+ *
+ * @param state the state of the generator.
+ * @param bound the bound of the number.
+ * @return int a number between 0 and bound - 1.
+ */
+int random_below(unsigned *state, int bound) {
+  *state = *state * 1103515245u + 12345u;
+  return (int) ((*state >> 8) % (unsigned) bound);
+}
+
+/**
+ * @brief compares two routes.
+ *
+ * @param a the first route, ended by -1, or NULL if there is no route.
+ * @param b the second route, ended by -1, or NULL if there is no route.
+ * @return true if the routes are the same.
+ * @return false otherwise.
+ */
+boolean same_route(const int *a, const int *b) {
+  if (a == NULL || b == NULL)
+    return a == b;
+
+  int i = 0;
+  while (a[i] == b[i] && a[i] != -1)
+    i++;
+
+  return a[i] == b[i];
+}
+
+/**
+ * @brief plans all the queries on the pinned version, again and again, then unpins it.
+ *
+ * @param unused the argument of the thread.
+ * @return void* NULL.
+ */
+void *plan_pinned(void *unused) {
+  for (int round = 0; round < test_rounds; round++)
+    for (int i = 0; i < test_queries; i++) {
+      int *route = plan_version(pinned, queries[i].distance1, queries[i].distance2);
+      if (!same_route(route, queries[i].expected))
+        mismatches++;
+      free(route);
+    }
+
+  // the tree has moved on, so this is the last reference to the version
+  unpin_version(pinned);
+  atomic_store(&planner_done, 1);
+  return unused;
+}
+
+/**
+ * @brief program execution entry point.
+ *
+ * @return int 0 if every plan on the pinned version matched, 1 otherwise.
+ */
+int main() {
+  unsigned state = 1;
+  null_station = init_station(-1);
+
+  // the stations are spaced so that the changes can add new ones between them
+  int distances[test_stations];
+  for (int i = 0; i < test_stations; i++) {
+    distances[i] = i * 10;
+    station_t *station = add_station(distances[i]);
+    add_car(station, random_below(&state, 80));
+  }
+
+  // the routes planned before any change, on the version that gets pinned
+  pinned = pin_version();
+  for (int i = 0; i < test_queries; i++) {
+    queries[i].distance1 = distances[random_below(&state, test_stations)];
+    queries[i].distance2 = distances[random_below(&state, test_stations)];
+    queries[i].expected = plan_version(pinned, queries[i].distance1, queries[i].distance2);
+  }
+
+  pthread_t planner;
+  if (pthread_create(&planner, NULL, plan_pinned, NULL) != 0) {
+    perror("pthread_create");
+    return 1;
+  }
+
+  // changes the stations and their cars while the planner reads the pinned version
+  int changes = 0;
+  for (; !atomic_load(&planner_done); changes++) {
+    int distance = distances[random_below(&state, test_stations)];
+    switch (random_below(&state, 4)) {
+      case 0:
+        remove_station(distance);
+        break;
+      case 1:
+        add_station(distance + 1 + random_below(&state, 9));
+        break;
+      default:
+        if (get_at(distance) != null_station)
+          add_car(get_at(distance), random_below(&state, 200));
+    }
+  }
+
+  pthread_join(planner, NULL);
+  // one more change frees the version unpinned by the planner
+  add_station(test_stations * 10);
+
+  boolean freed = atomic_load(&retired_versions) == NULL;
+  printf("version test: %d mismatches over %d plans during %d changes, retired versions %s\n", mismatches,
+         test_queries * test_rounds, changes, freed ? "freed" : "not freed");
+  return mismatches == 0 && freed ? 0 : 1;
+}